@@ -0,0 +1,651 @@
+#include "../src/ECS/ECS.h"
+#include "../src/ECS/Components.h"
+#include "../src/ECS/Systems.h"
+#include "../src/AssetStore/AssetStore.h"
+#include "../src/Game/Game.h"
+#include "../src/EventBus/EventBus.h"
+#include "../src/Logger/Logger.h"
+#include "../src/Renderer/RenderQueue.h"
+#include "../src/Renderer/RenderCommandList.h"
+#include "../src/Renderer/DebugDraw.h"
+#include "../src/Particles/ParticleEmitter.h"
+#include "../src/Tilemap/FogOfWar.h"
+#include "../src/Tilemap/Parallax.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+////////////////////////////////////////////////////////////////////////////////
+// ECS microbenchmarks
+////////////////////////////////////////////////////////////////////////////////
+// Headless, prints one CSV line per benchmark and entity count:
+// benchmark,entities,ops,ns_per_op,allocs_per_op
+////////////////////////////////////////////////////////////////////////////////
+
+// Count every heap allocation made by the process. The operators are not inlined, otherwise
+// GCC pairs the malloc() and free() inside them with the new/delete calls and warns about a mismatch.
+static std::atomic<long long> allocations{ 0 };
+
+__attribute__((noinline)) void* operator new(std::size_t size) 
+{
+	allocations++;
+	if (void* ptr = std::malloc(size ? size : 1)) 
+	{
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept { std::free(ptr); }
+__attribute__((noinline)) void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+// Measures the section between start() and stop(), several sections can be added up
+class Timer 
+{
+private:
+	std::chrono::steady_clock::time_point begin;
+	long long begin_allocs = 0;
+
+public:
+	double ns = 0.0;
+	long long allocs = 0;
+
+	void start() 
+	{
+		begin_allocs = allocations;
+		begin = std::chrono::steady_clock::now();
+	}
+
+	void stop() 
+	{
+		auto end = std::chrono::steady_clock::now();
+		allocs += allocations - begin_allocs;
+		ns += std::chrono::duration<double, std::nano>(end - begin).count();
+	}
+};
+
+// Runs the benchmark function, which returns the number of operations it timed
+template <typename Tfunc>
+void run(const char* name, int num_entities, Tfunc&& func) 
+{
+	Timer timer;
+	long long ops = func(timer, num_entities);
+	std::printf("%s,%d,%lld,%.2f,%.3f\n", name, num_entities, ops, timer.ns / ops, static_cast<double>(timer.allocs) / ops);
+	std::fflush(stdout);
+}
+
+static std::vector<Entity> create_movers(Registry& registry, int num_entities) 
+{
+	std::vector<Entity> entities;
+	entities.reserve(num_entities);
+	for (int i = 0; i < num_entities; i++) 
+	{
+		Entity ent = registry.CreateEntity();
+		ent.AddComponent<TransformComponent>(glm::vec2(i % 1280, i % 720), glm::vec2(1.0, 1.0), 0.0);
+		ent.AddComponent<RigidBodyComponent>(glm::vec2(10.0, 5.0));
+		entities.push_back(ent);
+	}
+	return entities;
+}
+
+// Software renderer drawing into a surface of the view's size, no window or GPU needed, with the
+// command list and batch a frame is recorded into and executed from, as the game and render threads do
+class RenderFixture 
+{
+public:
+	const SDL_Rect view = { 0, 0, 1280, 720 };
+	SDL_Surface* surface;
+	SDL_Renderer* renderer;
+	std::unique_ptr<AssetStore> asset_store;
+	RenderCommandList commands;
+	SpriteBatch batch;
+
+	// The image is packed into the atlas, an empty image_id loads none
+	explicit RenderFixture(const std::string& image_id = "", const std::string& image_path = "") 
+	{
+		surface = SDL_CreateRGBSurfaceWithFormat(0, view.w, view.h, 32, SDL_PIXELFORMAT_ARGB8888);
+		renderer = SDL_CreateSoftwareRenderer(surface);
+		asset_store = std::make_unique<AssetStore>();
+		if (!image_id.empty()) 
+		{
+			asset_store->add_texture(renderer, image_id, image_path);
+			asset_store->pack_atlas(renderer);
+		}
+	}
+
+	~RenderFixture() 
+	{
+		asset_store->clear_assets();
+		SDL_DestroyRenderer(renderer);
+		SDL_FreeSurface(surface);
+	}
+
+	void execute() { commands.execute(renderer, batch); }
+};
+
+// Square world of 32x32 tank sprites, row after row from the top left corner
+static void create_tank_grid(Registry& registry, int num_entities) 
+{
+	const int cols = static_cast<int>(std::sqrt(num_entities));
+	for (int i = 0; i < num_entities; i++) 
+	{
+		Entity ent = registry.CreateEntity();
+		ent.AddComponent<TransformComponent>(glm::vec2((i % cols) * 32, (i / cols) * 32), glm::vec2(1.0, 1.0), 0.0);
+		ent.AddComponent<SpriteComponent>("tank-image", 32, 32);
+	}
+}
+
+static long long bench_create_destroy(Timer& timer, int num_entities) 
+{
+	Registry registry;
+	registry.AddSystem<MovementSystem>();
+	registry.AddGroup<TransformComponent, RigidBodyComponent>();
+
+	timer.start();
+	auto entities = create_movers(registry, num_entities);
+	registry.update();
+	for (auto ent : entities) 
+	{
+		ent.Kill();
+	}
+	registry.update();
+	timer.stop();
+
+	return num_entities;
+}
+
+static long long bench_add_remove_component(Timer& timer, int num_entities) 
+{
+	Registry registry;
+	registry.AddGroup<TransformComponent, RigidBodyComponent>();
+	auto entities = create_movers(registry, num_entities);
+
+	timer.start();
+	for (auto ent : entities) 
+	{
+		ent.RemoveComponent<RigidBodyComponent>();
+	}
+	for (auto ent : entities) 
+	{
+		ent.AddComponent<RigidBodyComponent>(glm::vec2(1.0, 1.0));
+	}
+	timer.stop();
+
+	return 2LL * num_entities;
+}
+
+static long long bench_get_component(Timer& timer, int num_entities) 
+{
+	Registry registry;
+	auto entities = create_movers(registry, num_entities);
+
+	// Random order, so the lookups don't just walk the pool
+	std::shuffle(entities.begin(), entities.end(), std::mt19937(42));
+
+	const int rounds = 10;
+	float sum = 0.0f;
+	timer.start();
+	for (int round = 0; round < rounds; round++) 
+	{
+		for (auto ent : entities) 
+		{
+			sum += ent.GetComponent<TransformComponent>().pos.x;
+		}
+	}
+	timer.stop();
+
+	// Keep the loop from being optimized away
+	if (sum < 0.0f) 
+	{
+		std::printf("#%f\n", sum);
+	}
+	return static_cast<long long>(rounds) * num_entities;
+}
+
+static long long bench_movement_system(Timer& timer, int num_entities) 
+{
+	Registry registry;
+	registry.AddSystem<MovementSystem>();
+	registry.AddGroup<TransformComponent, RigidBodyComponent>();
+	create_movers(registry, num_entities);
+	registry.update();
+
+	const int frames = 100;
+	timer.start();
+	for (int frame = 0; frame < frames; frame++) 
+	{
+		registry.GetSystem<MovementSystem>().update(registry, 1.0 / 60.0);
+	}
+	timer.stop();
+
+	return static_cast<long long>(frames) * num_entities;
+}
+
+static long long bench_animation_system(Timer& timer, int num_entities) 
+{
+	static const AnimationClip clip = AnimationClip::FromStrip(0, 0, 32, 32, 4, 1.0f / 15.0f);
+
+	Registry registry;
+	registry.AddSystem<AnimationSystem>();
+	registry.AddGroup<AnimationComponent, SpriteComponent>();
+	for (int i = 0; i < num_entities; i++) 
+	{
+		Entity ent = registry.CreateEntity();
+		ent.AddComponent<SpriteComponent>("chopper-image", 32, 32);
+		ent.AddComponent<AnimationComponent>(&clip);
+	}
+	registry.update();
+
+	// Every sprite is animated, no visibility stamp
+	const int frames = 100;
+	timer.start();
+	for (int frame = 0; frame < frames; frame++) 
+	{
+		registry.GetSystem<AnimationSystem>().update(registry, 1.0 / 60.0);
+	}
+	timer.stop();
+
+	return static_cast<long long>(frames) * num_entities;
+}
+
+static long long bench_particles(Timer& timer, int num_particles) 
+{
+	RenderFixture fixture;
+
+	// Lifetimes long enough that the emitter stays full, the dead ones are respawned every frame
+	ParticleEmitter emitter(num_particles);
+	emitter.set_lifetime(0.5f, 2.0f);
+	emitter.set_gravity(100.0f);
+	emitter.emit(num_particles, 640.0f, 360.0f);
+
+	// Whole frames: simulated, recorded and drawn
+	const int frames = 60;
+	timer.start();
+	for (int frame = 0; frame < frames; frame++) 
+	{
+		emitter.update(1.0f / 60.0f);
+		emitter.emit(num_particles, 640.0f, 360.0f);
+		fixture.commands.reset();
+		emitter.render(fixture.commands, fixture.view);
+		fixture.execute();
+	}
+	timer.stop();
+
+	return static_cast<long long>(frames) * num_particles;
+}
+
+// Background of num_tiles trees covering the world, the camera scrolling over it. One entity per
+// tree, or a single parallax layer moving with the world. Ops are frames, recorded and executed.
+static long long bench_background(Timer& timer, int num_tiles, bool use_parallax) 
+{
+	RenderFixture fixture("tree-image", "./assets/images/tree.png");
+	const SDL_Rect view = fixture.view;
+	Registry registry;
+	registry.AddSystem<RenderSystem>();
+	Parallax parallax;
+	const int cols = static_cast<int>(std::sqrt(num_tiles));
+	const int rows = num_tiles / cols;
+	if (use_parallax) 
+	{
+		parallax.add_layer("tree-image", 1.0f, 2.0f, 0, 0, 0);
+		parallax.create_textures(fixture.renderer, *fixture.asset_store, view.w, view.h);
+		registry.GetSystem<RenderSystem>().set_parallax(&parallax);
+	}
+	else 
+	{
+		for (int i = 0; i < num_tiles; i++) 
+		{
+			Entity ent = registry.CreateEntity();
+			ent.AddComponent<TransformComponent>(glm::vec2((i % cols) * 32, (i / cols) * 64), glm::vec2(2.0, 2.0), 0.0);
+			ent.AddComponent<SpriteComponent>("tree-image", 16, 32);
+		}
+	}
+	registry.update();
+
+	SDL_Rect camera = view;
+	const int range_x = std::max(cols * 32 - view.w, 1);
+	const int range_y = std::max(rows * 64 - view.h, 1);
+	const int frames = 60;
+	timer.start();
+	for (int frame = 0; frame < frames; frame++) 
+	{
+		camera.x = (frame * 5) % range_x;
+		camera.y = (frame * 3) % range_y;
+		fixture.commands.reset();
+		parallax.bake(fixture.commands, *fixture.asset_store);
+		registry.GetSystem<RenderSystem>().update(fixture.commands, fixture.asset_store, camera);
+		fixture.execute();
+	}
+	timer.stop();
+
+	parallax.destroy();
+	return frames;
+}
+
+static long long bench_parallax(Timer& timer, int num_tiles) 
+{
+	return bench_background(timer, num_tiles, true);
+}
+
+static long long bench_parallax_entities(Timer& timer, int num_tiles) 
+{
+	return bench_background(timer, num_tiles, false);
+}
+
+static long long bench_fog_of_war(Timer& timer, int num_viewers) 
+{
+	// Viewers walking across a large map, most steps stay on the same tile
+	FogOfWar fog;
+	fog.resize(512, 512, 64.0f);
+	std::mt19937 rng(3);
+	std::uniform_real_distribution<float> coord(0.0f, 512.0f * 64.0f);
+	std::vector<glm::vec2> positions(num_viewers);
+	for (auto& pos : positions) 
+	{
+		pos = { coord(rng), coord(rng) };
+		fog.add_viewer(fog.col_at(pos.x), fog.row_at(pos.y), 6);
+	}
+
+	const int frames = 60;
+	timer.start();
+	for (int frame = 0; frame < frames; frame++) 
+	{
+		for (auto& pos : positions) 
+		{
+			const int col = fog.col_at(pos.x);
+			const int row = fog.row_at(pos.y);
+			pos += glm::vec2(3.0f, 2.0f);
+			fog.move_viewer(col, row, fog.col_at(pos.x), fog.row_at(pos.y), 6);
+		}
+	}
+	timer.stop();
+
+	return static_cast<long long>(frames) * num_viewers;
+}
+
+#ifdef DEBUG_DRAW
+static long long bench_debug_draw(Timer& timer, int num_boxes) 
+{
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> coord(0.0f, 1200.0f);
+	std::vector<SDL_FRect> boxes(num_boxes);
+	for (auto& box : boxes) 
+	{
+		box = { coord(rng), coord(rng) * 0.6f, 32.0f, 32.0f };
+	}
+
+	DebugDraw debug;
+	debug.set_enabled(true);
+	RenderCommandList commands;
+	const SDL_Rect camera = { 0, 0, 1280, 720 };
+	const int frames = 60;
+	timer.start();
+	for (int frame = 0; frame < frames; frame++) 
+	{
+		commands.reset();
+		for (const auto& box : boxes) 
+		{
+			debug.rect(box, { 0, 200, 0, 255 });
+		}
+		debug.flush(commands, camera);
+	}
+	timer.stop();
+
+	return static_cast<long long>(frames) * num_boxes;
+}
+#endif
+
+static long long bench_render_system(Timer& timer, int num_entities) 
+{
+	RenderFixture fixture("tank-image", "./assets/images/tank-panther-right.png");
+	Registry registry;
+	registry.AddSystem<RenderSystem>();
+	for (int i = 0; i < num_entities; i++) 
+	{
+		Entity ent = registry.CreateEntity();
+		ent.AddComponent<TransformComponent>(glm::vec2(i % 1280, (i / 1280) % 720), glm::vec2(1.0, 1.0), 0.0);
+		ent.AddComponent<SpriteComponent>("tank-image", 32, 32);
+	}
+	registry.update();
+
+	const int frames = 10;
+	timer.start();
+	for (int frame = 0; frame < frames; frame++) 
+	{
+		fixture.commands.reset();
+		registry.GetSystem<RenderSystem>().update(fixture.commands, fixture.asset_store, fixture.view);
+		fixture.execute();
+	}
+	timer.stop();
+
+	return static_cast<long long>(frames) * num_entities;
+}
+
+// A square world of 32x32 tiles where the camera only sees a 1280x720 corner
+static long long bench_render_culled(Timer& timer, int num_entities) 
+{
+	RenderFixture fixture("tank-image", "./assets/images/tank-panther-right.png");
+	Registry registry;
+	registry.AddSystem<RenderSystem>();
+	create_tank_grid(registry, num_entities);
+	registry.update();
+
+	const int frames = 10;
+	timer.start();
+	for (int frame = 0; frame < frames; frame++) 
+	{
+		fixture.commands.reset();
+		registry.GetSystem<RenderSystem>().update(fixture.commands, fixture.asset_store, fixture.view);
+		fixture.execute();
+	}
+	timer.stop();
+
+	return static_cast<long long>(frames) * num_entities;
+}
+
+// Same static scene as render_culled, with a few units moving over it, drawn the way the game does
+// in the dirty rectangle mode. The camera doesn't move, a scroll redraws the whole view.
+static long long bench_render_dirty(Timer& timer, int num_entities) 
+{
+	RenderFixture fixture("tank-image", "./assets/images/tank-panther-right.png");
+	SDL_Texture* backbuffer = SDL_CreateTexture(fixture.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, fixture.view.w, fixture.view.h);
+
+	Registry registry;
+	registry.AddSystem<RenderSystem>();
+	registry.GetSystem<RenderSystem>().set_dirty(true);
+	create_tank_grid(registry, num_entities);
+	std::vector<Entity> movers;
+	for (int i = 0; i < 8; i++) 
+	{
+		Entity ent = registry.CreateEntity();
+		ent.AddComponent<TransformComponent>(glm::vec2(100 + i * 120, 50 + i * 70), glm::vec2(1.0, 1.0), 0.0);
+		ent.AddComponent<RigidBodyComponent>(glm::vec2(60.0, 0.0));
+		ent.AddComponent<SpriteComponent>("tank-image", 32, 32, 0, 0, 1);
+		movers.push_back(ent);
+	}
+	registry.update();
+
+	DirtyRegions dirty_regions;
+	std::vector<SDL_Rect> baked_rects;
+	RenderSystem& render_system = registry.GetSystem<RenderSystem>();
+
+	// The first frame draws everything, it isn't timed
+	const int frames = 10;
+	for (int frame = 0; frame <= frames; frame++) 
+	{
+		for (auto ent : movers) 
+		{
+			auto& transform = ent.GetComponent<TransformComponent>();
+			transform.prev_pos = transform.pos;
+			transform.pos.x += 1.0f;
+		}
+
+		if (frame == 1) 
+		{
+			timer.start();
+		}
+		fixture.commands.reset();
+		Game::DrawDirtyRegions(fixture.commands, render_system, fixture.asset_store, nullptr, backbuffer, fixture.view, 1.0, frame == 0, 
+			dirty_regions, baked_rects);
+		fixture.execute();
+	}
+	timer.stop();
+
+	SDL_DestroyTexture(backbuffer);
+	return static_cast<long long>(frames) * num_entities;
+}
+
+// Builds the first level again and again, ops are levels. The entities column is the size of one level.
+static const int LEVEL_LOADS = 100;
+
+static long long bench_level_load(Timer& timer, int /*num_entities*/) 
+{
+	for (int level = 0; level < LEVEL_LOADS; level++) 
+	{
+		Registry registry;
+		registry.AddSystem<MovementSystem>();
+		registry.AddSystem<RenderSystem>();
+		registry.AddGroup<TransformComponent, RigidBodyComponent>();
+
+		Tilemap tilemap;
+
+		timer.start();
+		Game::BuildLevel(registry, tilemap, 1);
+		registry.update();
+		timer.stop();
+	}
+	return LEVEL_LOADS;
+}
+
+static int count_level_entities() 
+{
+	Registry registry;
+	Tilemap tilemap;
+	Game::BuildLevel(registry, tilemap, 1);
+	return registry.GetNumEntities();
+}
+
+// Sort keys shaped like the render system's: a few layers and textures, y scattered over the screen
+static long long bench_render_queue(Timer& timer, int num_sprites) 
+{
+	std::mt19937 rng(42);
+	std::vector<uint32_t> keys(num_sprites);
+	for (int i = 0; i < num_sprites; i++) 
+	{
+		const uint32_t layer = 128 + rng() % 3;
+		const uint32_t texture = rng() % 4;
+		const uint32_t y = 32768 + rng() % 720;
+		keys[i] = (layer << 24) | (texture << 16) | y;
+	}
+
+	RenderQueue queue;
+	const int frames = 20;
+	for (int frame = 0; frame <= frames; frame++) 
+	{
+		// The first frame grows the buffers
+		if (frame == 1) 
+		{
+			timer.start();
+		}
+		queue.clear();
+		for (int i = 0; i < num_sprites; i++) 
+		{
+			queue.push(keys[i], static_cast<uint32_t>(i));
+		}
+		queue.sort();
+	}
+	timer.stop();
+
+	if (queue.get_item(0) >= static_cast<uint32_t>(num_sprites)) 
+	{
+		std::printf("#%u\n", queue.get_item(0));
+	}
+	return static_cast<long long>(frames) * num_sprites;
+}
+
+struct BenchEvent 
+{
+	int entity_id;
+	float amount;
+
+	BenchEvent(int entity_id = 0, float amount = 0.0f) : entity_id{ entity_id }, amount{ amount } {}
+};
+
+struct BenchListener 
+{
+	float total = 0.0f;
+
+	void on_event(BenchEvent& event) { total += event.amount; }
+};
+
+static long long bench_event_bus(Timer& timer, int num_events) 
+{
+	EventBus event_bus;
+	BenchListener listener;
+	event_bus.SubscribeToEvent<BenchEvent, &BenchListener::on_event>(&listener);
+
+	// The first two frames grow both queue buffers, the following ones must not allocate
+	const int warmup_frames = 2;
+	const int frames = 10;
+	for (int frame = 0; frame < warmup_frames + frames; frame++) 
+	{
+		if (frame == warmup_frames) 
+		{
+			timer.start();
+		}
+		for (int i = 0; i < num_events; i++) 
+		{
+			event_bus.QueueEvent<BenchEvent>(i, 1.0f);
+		}
+		event_bus.DispatchQueuedEvents();
+	}
+	timer.stop();
+
+	if (listener.total < 0.0f) 
+	{
+		std::printf("#%f\n", listener.total);
+	}
+	return static_cast<long long>(frames) * num_events;
+}
+
+int main() 
+{
+	// The registry logs every entity and component, keep the output machine readable
+	Logger::level = LOG_ERROR;
+
+	const int entity_counts[] = { 1000, 10000, 100000 };
+
+	std::printf("benchmark,entities,ops,ns_per_op,allocs_per_op\n");
+	for (int num_entities : entity_counts) 
+	{
+		run("create_destroy", num_entities, bench_create_destroy);
+		run("add_remove_component", num_entities, bench_add_remove_component);
+		run("get_component", num_entities, bench_get_component);
+		run("movement_system", num_entities, bench_movement_system);
+		run("animation_system", num_entities, bench_animation_system);
+		run("render_system", num_entities, bench_render_system);
+		run("render_culled", num_entities, bench_render_culled);
+		run("render_dirty", num_entities, bench_render_dirty);
+		run("render_queue", num_entities, bench_render_queue);
+		run("event_bus", num_entities, bench_event_bus);
+		run("particles", num_entities, bench_particles);
+		run("fog_of_war", num_entities, bench_fog_of_war);
+	}
+	run("particles", 500000, bench_particles);
+	run("render_queue", 200000, bench_render_queue);
+	run("level_load", count_level_entities(), bench_level_load);
+	run("parallax", 10000, bench_parallax);
+	run("parallax_entities", 10000, bench_parallax_entities);
+#ifdef DEBUG_DRAW
+	run("debug_draw", 50000, bench_debug_draw);
+#endif
+
+	return 0;
+}
@@ -2,6 +2,29 @@
 #include "../Logger/Logger.h"
 
 #include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+// The implementation is static so it doesn't clash with the copy compiled into imgui
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include <imgui/imstb_rectpack.h>
+
+// An atlas page keeps its pixels and its packer, later levels fill the space left by the earlier ones
+struct AtlasPage
+{
+	stbrp_context context;
+	std::vector<stbrp_node> nodes;
+	SDL_Surface* surface = nullptr;
+	SDL_Texture* texture = nullptr;
+	int texture_index = 0;
+	bool dirty = false;
+};
+
+// Gap left between the packed images so filtering never samples a neighbour
+static const int ATLAS_PADDING = 1;
 
 AssetStore::AssetStore() 
 {
@@ -22,13 +45,98 @@ void AssetStore::clear_assets()
 		SDL_DestroyTexture(texture.second);
 	}
 	textures.clear();
+	texture_regions.clear();
+
+	for (auto& pending_image : pending_images)
+	{
+		SDL_FreeSurface(pending_image.second);
+	}
+	pending_images.clear();
+
+	for (auto& atlas_page : atlas_pages)
+	{
+		SDL_DestroyTexture(atlas_page->texture);
+		SDL_FreeSurface(atlas_page->surface);
+	}
+	atlas_pages.clear();
+	next_texture_index = 0;
+
+	for (auto& scaled_variant : scaled_variants)
+	{
+		SDL_DestroyTexture(scaled_variant.second.region.texture);
+	}
+	scaled_variants.clear();
+	requested_variants.clear();
+	for (auto& standalone_surface : standalone_surfaces)
+	{
+		SDL_FreeSurface(standalone_surface.second);
+	}
+	standalone_surfaces.clear();
+
+	for (auto& font_atlas : font_atlases)
+	{
+		font_atlas.second.destroy();
+	}
+	font_atlases.clear();
+
+	for (auto font : fonts)
+	{
+		TTF_CloseFont(font.second);
+	}
+	fonts.clear();
+}
+
+void AssetStore::check_render_phase(const std::string& asset_id)
+{
+	if (in_render_phase)
+	{
+		render_phase_loads++;
+		Logger::War("Asset " + asset_id + " was loaded during the render phase");
+		assert(!in_render_phase && "Assets must be loaded outside of the render phase");
+	}
 }
 
 void AssetStore::add_texture(SDL_Renderer* renderer, const std::string& asset_id, const std::string& file_path) 
 {
+	// Levels share assets, don't load (and leak) a texture twice
+	if (texture_regions.find(asset_id) != texture_regions.end())
+	{
+		return;
+	}
+	for (auto& pending_image : pending_images)
+	{
+		if (pending_image.first == asset_id)
+		{
+			return;
+		}
+	}
+
+	check_render_phase(asset_id);
+
 	SDL_Surface* surface = IMG_Load(file_path.c_str());
+	if (!surface)
+	{
+		Logger::Err("IMG_Load failed for " + file_path + ": " + IMG_GetError());
+		return;
+	}
+
+	// Small images are uploaded with their atlas page
+	if (surface->w <= ATLAS_MAX_IMAGE_SIZE && surface->h <= ATLAS_MAX_IMAGE_SIZE)
+	{
+		pending_images.emplace_back(asset_id, surface);
+		return;
+	}
+
 	SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-	SDL_FreeSurface(surface);
+	texture_regions.emplace(asset_id, TextureRegion{ texture, { 0, 0, surface->w, surface->h }, next_texture_index++ });
+	if (scaled_cache && texture)
+	{
+		standalone_surfaces.emplace(texture, surface);
+	}
+	else
+	{
+		SDL_FreeSurface(surface);
+	}
 
 	// Add the texture to the map
 	textures.emplace(asset_id, texture);
@@ -38,5 +146,306 @@ void AssetStore::add_texture(SDL_Renderer* renderer, const std::string& asset_id
 
 SDL_Texture* AssetStore::get_texture(const std::string& asset_id) 
 {
-	return textures[asset_id];
-}
\ No newline at end of file
+	const TextureRegion* texture_region = get_texture_region(asset_id);
+	return texture_region ? texture_region->texture : nullptr;
+}
+
+const TextureRegion* AssetStore::get_texture_region(const std::string& asset_id) const
+{
+	auto texture_region = texture_regions.find(asset_id);
+	return texture_region != texture_regions.end() ? &texture_region->second : nullptr;
+}
+
+void AssetStore::pack_atlas(SDL_Renderer* renderer)
+{
+	if (pending_images.empty())
+	{
+		return;
+	}
+
+	check_render_phase("atlas");
+
+	std::vector<stbrp_rect> rects(pending_images.size());
+	for (size_t i = 0; i < pending_images.size(); i++)
+	{
+		rects[i].id = static_cast<int>(i);
+		rects[i].w = pending_images[i].second->w + ATLAS_PADDING;
+		rects[i].h = pending_images[i].second->h + ATLAS_PADDING;
+		rects[i].was_packed = 0;
+	}
+
+	// Fill the existing pages first, then open new ones for what is left. Images are never
+	// bigger than ATLAS_MAX_IMAGE_SIZE, so an empty page always takes at least one.
+	size_t page_index = 0;
+	while (!rects.empty())
+	{
+		if (page_index == atlas_pages.size())
+		{
+			auto atlas_page = std::make_unique<AtlasPage>();
+			atlas_page->nodes.resize(ATLAS_PAGE_SIZE);
+			stbrp_init_target(&atlas_page->context, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, atlas_page->nodes.data(), ATLAS_PAGE_SIZE);
+			stbrp_setup_heuristic(&atlas_page->context, STBRP_HEURISTIC_Skyline_BL_sortHeight);
+			atlas_page->surface = SDL_CreateRGBSurfaceWithFormat(0, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, 32, SDL_PIXELFORMAT_RGBA32);
+			atlas_page->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE);
+			if (!atlas_page->surface || !atlas_page->texture)
+			{
+				Logger::Err("Error creating an atlas page: " + std::string(SDL_GetError()));
+				SDL_FreeSurface(atlas_page->surface);
+				SDL_DestroyTexture(atlas_page->texture);
+				break;
+			}
+			SDL_FillRect(atlas_page->surface, NULL, 0);
+			SDL_SetTextureBlendMode(atlas_page->texture, SDL_BLENDMODE_BLEND);
+			atlas_page->texture_index = next_texture_index++;
+			atlas_pages.push_back(std::move(atlas_page));
+		}
+
+		AtlasPage& atlas_page = *atlas_pages[page_index];
+		stbrp_pack_rects(&atlas_page.context, rects.data(), static_cast<int>(rects.size()));
+
+		for (auto& rect : rects)
+		{
+			if (!rect.was_packed)
+			{
+				continue;
+			}
+
+			// Copy the pixels as they are, alpha included
+			const std::string& asset_id = pending_images[rect.id].first;
+			SDL_Surface* surface = pending_images[rect.id].second;
+			SDL_Rect dst_rect = { rect.x, rect.y, surface->w, surface->h };
+			SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+			SDL_BlitSurface(surface, NULL, atlas_page.surface, &dst_rect);
+			texture_regions[asset_id] = TextureRegion{ atlas_page.texture, dst_rect, atlas_page.texture_index };
+			atlas_page.dirty = true;
+		}
+
+		rects.erase(std::remove_if(rects.begin(), rects.end(), [](const stbrp_rect& rect) { return rect.was_packed != 0; }), rects.end());
+		page_index++;
+	}
+
+	// Upload the pages that received new images
+	for (auto& atlas_page : atlas_pages)
+	{
+		if (atlas_page->dirty)
+		{
+			SDL_UpdateTexture(atlas_page->texture, NULL, atlas_page->surface->pixels, atlas_page->surface->pitch);
+			atlas_page->dirty = false;
+		}
+	}
+
+	for (auto& pending_image : pending_images)
+	{
+		SDL_FreeSurface(pending_image.second);
+	}
+	pending_images.clear();
+
+	Logger::Log("Texture atlas packed in " + std::to_string(atlas_pages.size()) + " pages");
+}
+
+SDL_Rect ScaledVariant::map_rect(const SDL_Rect& rect) const
+{
+	const int x0 = static_cast<int>(std::lround(rect.x * scale_x));
+	const int y0 = static_cast<int>(std::lround(rect.y * scale_y));
+	const int x1 = static_cast<int>(std::lround((rect.x + rect.w) * scale_x));
+	const int y1 = static_cast<int>(std::lround((rect.y + rect.h) * scale_y));
+
+	SDL_Rect mapped;
+	switch (quarter_turns)
+	{
+	case 1:
+		mapped = { scaled_h - y1, x0, y1 - y0, x1 - x0 };
+		break;
+	case 2:
+		mapped = { scaled_w - x1, scaled_h - y1, x1 - x0, y1 - y0 };
+		break;
+	case 3:
+		mapped = { y0, scaled_w - x1, y1 - y0, x1 - x0 };
+		break;
+	default:
+		mapped = { x0, y0, x1 - x0, y1 - y0 };
+		break;
+	}
+	mapped.x += region.rect.x;
+	mapped.y += region.rect.y;
+	return mapped;
+}
+
+const ScaledVariant* AssetStore::get_scaled_variant(const TextureRegion& image, float scale_x, float scale_y, double rotation)
+{
+	if (!scaled_cache)
+	{
+		return nullptr;
+	}
+
+	// Only the rotations that move whole pixels
+	const double turns = rotation / 90.0;
+	const double whole_turns = std::round(turns);
+	if (std::abs(turns - whole_turns) > 0.001)
+	{
+		return nullptr;
+	}
+
+	ScaledKey key;
+	key.image = &image;
+	key.scale_x = static_cast<int>(std::lround(scale_x * 1000.0f));
+	key.scale_y = static_cast<int>(std::lround(scale_y * 1000.0f));
+	key.quarter_turns = ((static_cast<int>(whole_turns) % 4) + 4) % 4;
+	if ((key.scale_x == 1000 && key.scale_y == 1000 && key.quarter_turns == 0) || 
+		key.scale_x <= 0 || key.scale_y <= 0 || key.scale_x > 8000 || key.scale_y > 8000)
+	{
+		return nullptr;
+	}
+
+	auto scaled_variant = scaled_variants.find(key);
+	if (scaled_variant != scaled_variants.end())
+	{
+		return scaled_variant->second.region.texture ? &scaled_variant->second : nullptr;
+	}
+	if (static_cast<int>(scaled_variants.size()) >= MAX_SCALED_VARIANTS)
+	{
+		return nullptr;
+	}
+
+	ScaledVariant variant;
+	variant.region = TextureRegion{ nullptr, { 0, 0, 0, 0 }, -1 };
+	variant.scale_x = key.scale_x / 1000.0f;
+	variant.scale_y = key.scale_y / 1000.0f;
+	variant.quarter_turns = key.quarter_turns;
+	variant.scaled_w = static_cast<int>(std::lround(image.rect.w * variant.scale_x));
+	variant.scaled_h = static_cast<int>(std::lround(image.rect.h * variant.scale_y));
+	scaled_variants.emplace(key, variant);
+	requested_variants.push_back(key);
+	return nullptr;
+}
+
+SDL_Surface* AssetStore::find_image_pixels(const TextureRegion& image) const
+{
+	for (const auto& atlas_page : atlas_pages)
+	{
+		if (atlas_page->texture == image.texture)
+		{
+			return atlas_page->surface;
+		}
+	}
+	auto standalone_surface = standalone_surfaces.find(image.texture);
+	return standalone_surface != standalone_surfaces.end() ? standalone_surface->second : nullptr;
+}
+
+void AssetStore::build_scaled_variants(SDL_Renderer* renderer)
+{
+	if (requested_variants.empty())
+	{
+		return;
+	}
+
+	check_render_phase("scaled variants");
+
+	for (const auto& key : requested_variants)
+	{
+		build_scaled_variant(renderer, scaled_variants[key], *key.image);
+	}
+	Logger::Log("Built " + std::to_string(requested_variants.size()) + " scaled texture variants");
+	requested_variants.clear();
+}
+
+void AssetStore::build_scaled_variant(SDL_Renderer* renderer, ScaledVariant& variant, const TextureRegion& image)
+{
+	SDL_Surface* pixels = find_image_pixels(image);
+	if (!pixels || variant.scaled_w <= 0 || variant.scaled_h <= 0)
+	{
+		Logger::Err("No pixels to build a scaled variant from");
+		return;
+	}
+
+	// Nearest neighbour, like the renderer scales at draw time
+	SDL_Surface* source = SDL_ConvertSurfaceFormat(pixels, SDL_PIXELFORMAT_RGBA32, 0);
+	SDL_Surface* scaled = SDL_CreateRGBSurfaceWithFormat(0, variant.scaled_w, variant.scaled_h, 32, SDL_PIXELFORMAT_RGBA32);
+	const bool turned = variant.quarter_turns % 2 == 1;
+	SDL_Surface* rotated = SDL_CreateRGBSurfaceWithFormat(0, turned ? variant.scaled_h : variant.scaled_w, turned ? variant.scaled_w : variant.scaled_h, 32, SDL_PIXELFORMAT_RGBA32);
+	if (!source || !scaled || !rotated)
+	{
+		Logger::Err("Error creating a scaled variant: " + std::string(SDL_GetError()));
+		SDL_FreeSurface(source);
+		SDL_FreeSurface(scaled);
+		SDL_FreeSurface(rotated);
+		return;
+	}
+	SDL_SetSurfaceBlendMode(source, SDL_BLENDMODE_NONE);
+	SDL_Rect src_rect = image.rect;
+	SDL_BlitScaled(source, &src_rect, scaled, NULL);
+
+	// Turn clockwise, pixel by pixel
+	for (int y = 0; y < scaled->h; y++)
+	{
+		const Uint32* src_row = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(scaled->pixels) + y * scaled->pitch);
+		for (int x = 0; x < scaled->w; x++)
+		{
+			int dst_x = x, dst_y = y;
+			switch (variant.quarter_turns)
+			{
+			case 1: dst_x = scaled->h - 1 - y; dst_y = x; break;
+			case 2: dst_x = scaled->w - 1 - x; dst_y = scaled->h - 1 - y; break;
+			case 3: dst_x = y; dst_y = scaled->w - 1 - x; break;
+			default: break;
+			}
+			Uint32* dst_row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(rotated->pixels) + dst_y * rotated->pitch);
+			dst_row[dst_x] = src_row[x];
+		}
+	}
+
+	SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, rotated);
+	SDL_FreeSurface(source);
+	SDL_FreeSurface(scaled);
+	SDL_FreeSurface(rotated);
+	if (!texture)
+	{
+		Logger::Err("Error creating a scaled variant texture: " + std::string(SDL_GetError()));
+		return;
+	}
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+	int width = 0, height = 0;
+	SDL_QueryTexture(texture, NULL, NULL, &width, &height);
+	variant.region = TextureRegion{ texture, { 0, 0, width, height }, next_texture_index++ };
+}
+
+void AssetStore::add_font(SDL_Renderer* renderer, const std::string& asset_id, const std::string& file_path, int font_size)
+{
+	if (fonts.find(asset_id) != fonts.end())
+	{
+		return;
+	}
+
+	check_render_phase(asset_id);
+
+	TTF_Font* font = TTF_OpenFont(file_path.c_str(), font_size);
+	if (!font)
+	{
+		Logger::Err("TTF_OpenFont failed for " + file_path + ": " + TTF_GetError());
+		return;
+	}
+
+	// Rasterize the glyphs once, text is then drawn from the atlas texture
+	FontAtlas font_atlas;
+	if (!font_atlas.build(renderer, font))
+	{
+		TTF_CloseFont(font);
+		return;
+	}
+	fonts.emplace(asset_id, font);
+	font_atlases.emplace(asset_id, font_atlas);
+
+	Logger::Log("New font added to the asset store with id = " + asset_id);
+}
+
+TTF_Font* AssetStore::get_font(const std::string& asset_id)
+{
+	return fonts[asset_id];
+}
+
+const FontAtlas* AssetStore::get_font_atlas(const std::string& asset_id) const
+{
+	auto font_atlas = font_atlases.find(asset_id);
+	return font_atlas != font_atlases.end() ? &font_atlas->second : nullptr;
+}
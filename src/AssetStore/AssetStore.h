@@ -2,20 +2,100 @@
 #define ASSETSTORE_H
 
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 #define SDL_MAIN_HANDLED
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_mixer.h>
 #include <SDL2/SDL_ttf.h>
 
+#include "../Renderer/FontAtlas.h"
+
+// Where an image ended up: its own texture, or a sub-rectangle of an atlas page
+struct TextureRegion
+{
+	SDL_Texture* texture;
+	SDL_Rect rect;
+	// Small number identifying the texture, to sort draws by texture
+	int texture_index;
+};
+
+// Copy of an image already scaled and turned by a multiple of 90 degrees clockwise, drawn 1:1
+struct ScaledVariant
+{
+	// texture is nullptr until the variant is built
+	TextureRegion region;
+	float scale_x;
+	float scale_y;
+	int quarter_turns;
+	// Size of the image once scaled, before it is turned
+	int scaled_w;
+	int scaled_h;
+
+	// Where a rectangle of the original image ends up in region
+	SDL_Rect map_rect(const SDL_Rect& rect) const;
+};
+
+struct AtlasPage;
+
 class AssetStore
 {
 private:
+	// Images bigger than this keep their own texture, smaller ones are packed into atlas pages
+	static constexpr int ATLAS_MAX_IMAGE_SIZE = 256;
+	static constexpr int ATLAS_PAGE_SIZE = 1024;
+
+	// Textures owned by a single image
 	std::map<std::string, SDL_Texture*> textures;
+	// Every image, standalone or packed
+	std::map<std::string, TextureRegion> texture_regions;
+
+	// Small images are decoded by add_texture() and wait for pack_atlas() to be given a place in a page
+	std::vector<std::pair<std::string, SDL_Surface*>> pending_images;
+	std::vector<std::unique_ptr<AtlasPage>> atlas_pages;
+	int next_texture_index = 0;
+
+	// Pre-scaled and pre-rotated images, for renderers that scale every pixel in software.
+	// They are requested while drawing and built between frames by build_scaled_variants().
+	static constexpr int MAX_SCALED_VARIANTS = 256;
+	struct ScaledKey
+	{
+		const TextureRegion* image;
+		// Thousandths
+		int scale_x;
+		int scale_y;
+		int quarter_turns;
+
+		bool operator<(const ScaledKey& other) const
+		{
+			if (image != other.image) return image < other.image;
+			if (scale_x != other.scale_x) return scale_x < other.scale_x;
+			if (scale_y != other.scale_y) return scale_y < other.scale_y;
+			return quarter_turns < other.quarter_turns;
+		}
+	};
+	bool scaled_cache = false;
+	std::map<ScaledKey, ScaledVariant> scaled_variants;
+	std::vector<ScaledKey> requested_variants;
+	// Pixels of the images that have their own texture, kept to build their variants
+	std::map<SDL_Texture*, SDL_Surface*> standalone_surfaces;
+
+	SDL_Surface* find_image_pixels(const TextureRegion& image) const;
+	void build_scaled_variant(SDL_Renderer* renderer, ScaledVariant& variant, const TextureRegion& image);
+
 	std::map<std::string, TTF_Font*> fonts;
+	std::map<std::string, FontAtlas> font_atlases;
 	std::map<std::string, Mix_Chunk*> sounds;
 
+	// Loading an asset means a disk read, a decode and a GPU upload, which must never happen
+	// while a frame is being rendered. The game marks its render phase and such loads are flagged.
+	bool in_render_phase = false;
+	int render_phase_loads = 0;
+
+	void check_render_phase(const std::string& asset_id);
+
 public:
 	AssetStore();
 	~AssetStore();
@@ -23,7 +103,29 @@ public:
 	void clear_assets();
 	void add_texture(SDL_Renderer* renderer, const std::string& asset_id, const std::string& file_path);
 	SDL_Texture* get_texture(const std::string& asset_id);
+	// nullptr until the image is loaded, and for small images until the atlas is packed
+	const TextureRegion* get_texture_region(const std::string& asset_id) const;
+
+	// Places the images added since the last call into the atlas pages and uploads the pages that changed
+	void pack_atlas(SDL_Renderer* renderer);
+	int get_atlas_page_count() const { return static_cast<int>(atlas_pages.size()); }
+
+	// Call before adding textures, the images need to stay in memory to be scaled later
+	void set_scaled_cache(bool enabled) { scaled_cache = enabled; }
+	// The variant of the image for this scale and rotation, nullptr when it doesn't apply or isn't built yet.
+	// A missing variant is requested, safe to call during the render phase.
+	const ScaledVariant* get_scaled_variant(const TextureRegion& image, float scale_x, float scale_y, double rotation);
+	bool has_requested_variants() const { return !requested_variants.empty(); }
+	// Creates the variants requested since the last call, outside of the render phase
+	void build_scaled_variants(SDL_Renderer* renderer);
 
+	// Opens the font at the given size and rasterizes its glyph atlas, one asset id per font and size
+	void add_font(SDL_Renderer* renderer, const std::string& asset_id, const std::string& file_path, int font_size);
+	TTF_Font* get_font(const std::string& asset_id);
+	const FontAtlas* get_font_atlas(const std::string& asset_id) const;
 
+	void begin_render_phase() { in_render_phase = true; }
+	void end_render_phase() { in_render_phase = false; }
+	int get_render_phase_loads() const { return render_phase_loads; }
 };
 #endif
@@ -3,6 +3,7 @@
 
 #include <glm/glm.hpp>
 #include <string>
+#include <vector>
 #define SDL_MAIN_HANDLED
 #include <SDL2/SDL.h>
 
@@ -14,18 +15,89 @@ struct RigidBodyComponent
 
 };
 
+struct KeyboardControlledComponent 
+{
+	float speed;
+
+	KeyboardControlledComponent(float speed = 0.0f) : speed{ speed } {}
+};
+
+// The camera stays centered on the entity with this component
+struct CameraFollowComponent 
+{
+};
+
+// Entities with this component reappear on the opposite edge when they leave the screen
+struct WrapAroundComponent 
+{
+};
+
+// Uncovers the tiles within radius tiles of the entity in the fog of war
+struct VisionComponent 
+{
+	int radius;
+
+	VisionComponent(int radius = 4) : radius{ radius } {}
+};
+
+// Units shown as a blip of this color on the minimap
+struct MinimapBlipComponent 
+{
+	SDL_Color color;
+
+	MinimapBlipComponent(SDL_Color color = { 255, 255, 255, 255 }) : color{ color } {}
+};
+
 struct SpriteComponent 
 {
 	std::string asset_id;
 	int width;
 	int height;
 	SDL_Rect src_rect;
+	// Higher layers are drawn above, in [-128, 127]
+	int z_index;
+	// Stamp of the last frame the sprite was drawn in, set by the render system
+	Uint32 visible_frame;
 
-	SpriteComponent(std::string asset_id = "", int width = 0, int height = 0, int src_rectX = 0, int src_rectY = 0) : 
+	SpriteComponent(std::string asset_id = "", int width = 0, int height = 0, int src_rectX = 0, int src_rectY = 0, int z_index = 0) : 
 		asset_id{ asset_id }, 
 		width{ width }, 
 		height{ height }, 
-		src_rect{src_rectX, src_rectY, width, height} {}
+		src_rect{src_rectX, src_rectY, width, height}, 
+		z_index{ z_index },
+		visible_frame{ 0 } {}
+};
+
+// Frames of an animation, computed once and shared by every entity that plays it
+struct AnimationClip 
+{
+	std::vector<SDL_Rect> frames;
+	// Seconds each frame stays on screen
+	std::vector<float> durations;
+	bool looping = true;
+
+	// num_frames frames of w x h laid out left to right from (x, y) in the sprite sheet
+	static AnimationClip FromStrip(int x, int y, int w, int h, int num_frames, float frame_duration, bool looping = true) 
+	{
+		AnimationClip clip;
+		for (int i = 0; i < num_frames; i++) 
+		{
+			clip.frames.push_back({ x + i * w, y, w, h });
+			clip.durations.push_back(frame_duration);
+		}
+		clip.looping = looping;
+		return clip;
+	}
+};
+
+// Per entity playback state, the clip itself is never copied
+struct AnimationComponent 
+{
+	const AnimationClip* clip;
+	int frame;
+	float time;
+
+	AnimationComponent(const AnimationClip* clip = nullptr) : clip{ clip }, frame{ 0 }, time{ 0.0f } {}
 };
 
 struct TransformComponent
@@ -34,11 +106,17 @@ struct TransformComponent
 	glm::vec2 scale;
 	double rot;
 
+	// State before the last simulation step, the render interpolates between it and the current one
+	glm::vec2 prev_pos;
+	double prev_rot;
+
 	TransformComponent(glm::vec2 position = glm::vec2(0, 0), glm::vec2 scale = glm::vec2(1, 1), double rotation = 0.0) 
 	{
 		this->pos = position;
 		this->scale = scale;
 		this->rot = rotation;
+		this->prev_pos = position;
+		this->prev_rot = rotation;
 	}
 };
 #endif
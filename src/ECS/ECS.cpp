@@ -2,31 +2,58 @@
 #include "../Logger/Logger.h"
 #include <algorithm>
 
-int Icomp::next_id = 0;     // class' static fields have to be initialized
+std::atomic<int> Icomp::next_id{ 0 };     // class' static fields have to be initialized
 
 int Entity::GetId() const { return id; }
 
-void System::AddEntityToSystem(Entity entity) { entities.push_back(entity); }
+void Entity::Kill() { reg->KillEntity(*this); }
+
+void System::AddEntityToSystem(Entity entity) 
+{ 
+	entities.push_back(entity); 
+	OnEntityAdded(entity);
+}
 
 void System::RemoveEntityFromSystem(Entity entity) 
 {
-	entities.erase(std::remove_if(entities.begin(),
+	auto removed = std::remove_if(entities.begin(),
 		entities.end(),
-		[&entity](Entity other) { return entity == other; } ),
-		entities.end());
+		[&entity](Entity other) { return entity == other; } );
+	if (removed == entities.end()) 
+	{
+		return;
+	}
+	entities.erase(removed, entities.end());
+	OnEntityRemoved(entity);
+}
+
+void System::ClearSystemEntities() 
+{ 
+	entities.clear(); 
+	OnEntitiesCleared();
 }
 
-std::vector<Entity> System::GetSystemEntities() const { return entities; }
+const std::vector<Entity>& System::GetSystemEntities() const { return entities; }
 
 const Signature& System::GetComponentSignature() const { return comp_sign; }
 
 Entity Registry::CreateEntity() {
-	int entity_id = num_entities++;
+	int entity_id;
 
 	// if there are no free ids waiting to be reused
-	if (entity_id >= entityComponentSignatures.size()) 
+	if (free_ids.empty()) 
+	{
+		entity_id = num_entities++;
+		if (entity_id >= static_cast<int>(entityComponentSignatures.size())) 
+		{
+			entityComponentSignatures.resize(entity_id + 1);
+		}
+	}
+	else 
 	{
-		entityComponentSignatures.resize(entity_id + 1);
+		// Reuse an id from the list of previously removed entities
+		entity_id = free_ids.front();
+		free_ids.pop_front();
 	}
 	
 	Entity ent(entity_id);
@@ -38,6 +65,123 @@ Entity Registry::CreateEntity() {
 	return ent;
 }
 
+void Registry::KillEntity(Entity ent) {
+	entities_to_kill.insert(ent);
+}
+
+void Registry::Clear() {
+	num_entities = 0;
+	free_ids.clear();
+	entityComponentSignatures.clear();
+	entities_to_add.clear();
+	entities_to_kill.clear();
+
+	for (auto& pool : comp_pools) 
+	{
+		if (pool) 
+		{
+			pool->clear();
+		}
+	}
+	for (auto& group : groups) 
+	{
+		group.second->clear();
+	}
+	for (auto& system : systems) 
+	{
+		system.second->ClearSystemEntities();
+	}
+
+	Logger::Log("Registry cleared");
+}
+
+void Registry::Merge(Registry& other) {
+	// Killed (or about to be killed) entities of the other world are not brought over
+	std::vector<bool> is_dead(other.num_entities, false);
+	for (auto entity_id : other.free_ids) 
+	{
+		is_dead[entity_id] = true;
+	}
+	for (auto ent : other.entities_to_kill) 
+	{
+		is_dead[ent.GetId()] = true;
+		for (auto& pool : other.comp_pools) 
+		{
+			if (pool) 
+			{
+				pool->remove(ent.GetId());
+			}
+		}
+	}
+
+	// Give every live entity of the other world a new id at the end of this world
+	const int first_id = num_entities;
+	std::vector<int> id_remap(other.num_entities, -1);
+	for (int entity_id = 0; entity_id < other.num_entities; entity_id++) 
+	{
+		if (!is_dead[entity_id]) 
+		{
+			id_remap[entity_id] = num_entities++;
+		}
+	}
+	entityComponentSignatures.resize(num_entities);
+	for (int entity_id = 0; entity_id < other.num_entities; entity_id++) 
+	{
+		if (!is_dead[entity_id]) 
+		{
+			entityComponentSignatures[id_remap[entity_id]] = other.entityComponentSignatures[entity_id];
+		}
+	}
+
+	// Move the component pools in bulk, creating the ones this world doesn't have yet
+	if (other.comp_pools.size() > comp_pools.size()) 
+	{
+		comp_pools.resize(other.comp_pools.size(), nullptr);
+		comp_owners.resize(other.comp_pools.size(), nullptr);
+	}
+	for (size_t comp_id = 0; comp_id < other.comp_pools.size(); comp_id++) 
+	{
+		if (!other.comp_pools[comp_id]) 
+		{
+			continue;
+		}
+		if (!comp_pools[comp_id]) 
+		{
+			comp_pools[comp_id] = other.comp_pools[comp_id]->clone_empty();
+		}
+		comp_pools[comp_id]->merge(*other.comp_pools[comp_id], id_remap);
+	}
+
+	// Pack the new entities into this world's groups and queue them for the systems
+	for (int entity_id = first_id; entity_id < num_entities; entity_id++) 
+	{
+		for (auto& group : groups) 
+		{
+			group.second->on_add(entity_id, entityComponentSignatures[entity_id]);
+		}
+		Entity ent(entity_id);
+		ent.reg = this;
+		entities_to_add.insert(ent);
+	}
+
+	// The other world is left without entities
+	other.num_entities = 0;
+	other.free_ids.clear();
+	other.entityComponentSignatures.clear();
+	other.entities_to_add.clear();
+	other.entities_to_kill.clear();
+	for (auto& group : other.groups) 
+	{
+		group.second->clear();
+	}
+	for (auto& system : other.systems) 
+	{
+		system.second->ClearSystemEntities();
+	}
+
+	Logger::Log("Merged " + std::to_string(num_entities - first_id) + " entities into the registry");
+}
+
 void Registry::AddEntityToSystems(Entity ent) {
 	const auto entity_id = ent.GetId();
 
@@ -58,6 +202,13 @@ void Registry::AddEntityToSystems(Entity ent) {
 	}
 }
 
+void Registry::RemoveEntityFromSystems(Entity ent) {
+	for (auto& system : systems) 
+	{
+		system.second->RemoveEntityFromSystem(ent);
+	}
+}
+
 void Registry::update() {
 	// Here is where we actually insert/delete the entities that are waiting to be added/removed.
 	// We do this because we don't want to confuse our Systems by adding/removing entities in the middle
@@ -73,5 +224,29 @@ void Registry::update() {
 	entities_to_add.clear();
 
 	// Remove the entities that are waiting to be killed from the active Systems
+	for (auto ent : entities_to_kill) 
+	{
+		const auto entity_id = ent.GetId();
+		RemoveEntityFromSystems(ent);
 
+		// Take the entity out of the groups before its components leave the pools
+		for (auto& group : groups) 
+		{
+			group.second->on_remove(entity_id);
+		}
+		for (auto& pool : comp_pools) 
+		{
+			if (pool) 
+			{
+				pool->remove(entity_id);
+			}
+		}
+		entityComponentSignatures[entity_id].reset();
+
+		// Make the entity id available to be reused
+		free_ids.push_back(entity_id);
+
+		Logger::Log("Entity killed with id " + std::to_string(entity_id));
+	}
+	entities_to_kill.clear();
 }
@@ -5,9 +5,12 @@
 #include <vector>
 #include <bitset>
 #include <set>
+#include <deque>
 #include <unordered_map>
 #include <typeindex>
 #include <memory>
+#include <tuple>
+#include <atomic>
 #include <iostream>
 
 
@@ -24,7 +27,8 @@ typedef std::bitset<MAX_COMPS> Signature;
 struct Icomp 
 {
 protected:
-	static int next_id;
+	// Atomic so that worlds can be built on several threads at once
+	static std::atomic<int> next_id;
 };
 
 // Used to assign a unique id to a component type
@@ -51,6 +55,7 @@ public:
 	Entity(int id) : id(id) {};
 	Entity(const Entity& ent) = default;  // copy constructor
 	int GetId() const;
+	void Kill();
 
 	// Manage entity tags and groups
 
@@ -84,13 +89,20 @@ private:
 	Signature comp_sign;
 	std::vector<Entity> entities;
 
+protected:
+	// Let a system keep its own acceleration structures in sync with its entities
+	virtual void OnEntityAdded(Entity ent) {}
+	virtual void OnEntityRemoved(Entity ent) {}
+	virtual void OnEntitiesCleared() {}
+
 public:
 	System() = default;
-	~System() = default;
+	virtual ~System() = default;
 
 	void AddEntityToSystem(Entity ent);
 	void RemoveEntityFromSystem(Entity ent);
-	std::vector<Entity> GetSystemEntities() const;
+	void ClearSystemEntities();
+	const std::vector<Entity>& GetSystemEntities() const;
 	const Signature& GetComponentSignature() const;
 
 	// Defines the component type that entities must have to be considered by the system
@@ -106,19 +118,36 @@ class Ipool
 {
 public:
 	virtual ~Ipool() = default;
+	virtual void clear() = 0;
+	virtual void remove(int entity_id) = 0;
+
+	// Creates an empty pool of the same component type
+	virtual std::shared_ptr<Ipool> clone_empty() const = 0;
+
+	// Moves every component of another pool of the same type into this one,
+	// translating its entity ids with id_remap [index = entity id in the other pool]
+	virtual void merge(Ipool& other, const std::vector<int>& id_remap) = 0;
 };
 
 template <typename T>
 class Pool : public Ipool 
 {
 private:
-	// We keep track of the vector of objects and the current number of elementities
+	// We keep track of the vector of objects, the vector is always packed (no holes)
 	std::vector<T> data;
 
 	// Helper maps to keep track of entity ids per index, so the vector is always packed
+	// [entity_to_index index = entity id, -1 if the entity has no component in this pool]
+	// [index_to_entity index = packed index]
+	std::vector<int> entity_to_index;
+	std::vector<int> index_to_entity;
 
 public:
-	Pool(int cap = 100)	{ data.resize(cap); }
+	Pool(int cap = 100)	
+	{ 
+		data.reserve(cap); 
+		index_to_entity.reserve(cap);
+	}
 
 	virtual ~Pool() = default;
 
@@ -126,19 +155,192 @@ public:
 
 	int get_size() const { return data.size();	}
 
-	void resize(int n) { data.resize(n); }
+	void clear() override 
+	{ 
+		data.clear(); 
+		entity_to_index.clear();
+		index_to_entity.clear();
+	}
 
-	void clear() { data.clear(); }
+	std::shared_ptr<Ipool> clone_empty() const override { return std::make_shared<Pool<T>>(); }
 
-	void add(T obj) { data.push_back(obj); }
+	void merge(Ipool& other, const std::vector<int>& id_remap) override 
+	{
+		auto& src = static_cast<Pool<T>&>(other);
+
+		if (data.empty()) 
+		{
+			// Nothing to keep, so steal the other vectors instead of moving the components one by one
+			data = std::move(src.data);
+			index_to_entity = std::move(src.index_to_entity);
+			entity_to_index.clear();
+			for (int idx = 0; idx < static_cast<int>(index_to_entity.size()); idx++) 
+			{
+				const int entity_id = id_remap[index_to_entity[idx]];
+				if (entity_id >= static_cast<int>(entity_to_index.size())) 
+				{
+					entity_to_index.resize(entity_id + 1, -1);
+				}
+				index_to_entity[idx] = entity_id;
+				entity_to_index[entity_id] = idx;
+			}
+		}
+		else 
+		{
+			data.reserve(data.size() + src.data.size());
+			index_to_entity.reserve(index_to_entity.size() + src.index_to_entity.size());
+			for (int idx = 0; idx < static_cast<int>(src.data.size()); idx++) 
+			{
+				set(id_remap[src.index_to_entity[idx]], std::move(src.data[idx]));
+			}
+		}
+		src.clear();
+	}
+
+	bool has(int entity_id) const 
+	{ 
+		return entity_id < static_cast<int>(entity_to_index.size()) && entity_to_index[entity_id] != -1; 
+	}
 
-	void set(int idx, T obj) { data[idx] = obj;	}
+	int index_of(int entity_id) const { return entity_to_index[entity_id]; }
 
-	T& get(int idx) { return static_cast<T&>(data[idx]); }
+	int entity_at(int idx) const { return index_to_entity[idx]; }
+
+	// Adds the object at the end of the packed vector, or overwrites it if the entity already has one
+	void set(int entity_id, T obj) 
+	{
+		if (has(entity_id)) 
+		{
+			data[entity_to_index[entity_id]] = std::move(obj);
+			return;
+		}
+		if (entity_id >= static_cast<int>(entity_to_index.size())) 
+		{
+			entity_to_index.resize(entity_id + 1, -1);
+		}
+		entity_to_index[entity_id] = data.size();
+		index_to_entity.push_back(entity_id);
+		data.push_back(std::move(obj));
+	}
+
+	// Moves the last element into the removed slot to keep the vector packed
+	void remove(int entity_id) override 
+	{
+		if (!has(entity_id)) 
+		{
+			return;
+		}
+		swap(entity_to_index[entity_id], data.size() - 1);
+		entity_to_index[entity_id] = -1;
+		index_to_entity.pop_back();
+		data.pop_back();
+	}
+
+	// Swaps two packed slots, used by groups to keep their entities at the front of the pool
+	void swap(int idx_a, int idx_b) 
+	{
+		if (idx_a == idx_b) 
+		{
+			return;
+		}
+		std::swap(data[idx_a], data[idx_b]);
+		std::swap(index_to_entity[idx_a], index_to_entity[idx_b]);
+		entity_to_index[index_to_entity[idx_a]] = idx_a;
+		entity_to_index[index_to_entity[idx_b]] = idx_b;
+	}
+
+	T& get(int entity_id) { return data[entity_to_index[entity_id]]; }
+
+	T* raw() { return data.data(); }
 
 	T& operator [](unsigned int idx) { return data[idx]; }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// Group
+////////////////////////////////////////////////////////////////////////////////
+// An owning group keeps the entities that have all of its components packed at
+// the front of every owned pool and in the same order, so iterating the group
+// is a parallel linear scan of the pools with no entity id lookups.
+// A component type can only be owned by one group.
+////////////////////////////////////////////////////////////////////////////////
+class Igroup 
+{
+protected:
+	Signature group_sign;
+	int size = 0;
+
+public:
+	virtual ~Igroup() = default;
+
+	int get_size() const { return size; }
+
+	void clear() { size = 0; }
+
+	const Signature& GetComponentSignature() const { return group_sign; }
+
+	// Called by the registry after a component was added to / before it is removed from an entity
+	virtual void on_add(int entity_id, const Signature& entity_sign) = 0;
+	virtual void on_remove(int entity_id) = 0;
+};
+
+template <typename ...Towned>
+class Group : public Igroup 
+{
+private:
+	std::tuple<std::shared_ptr<Pool<Towned>>...> pools;
+
+public:
+	Group(std::shared_ptr<Pool<Towned>>... owned_pools) : pools{ owned_pools... } 
+	{
+		(group_sign.set(Component<Towned>::GetId()), ...);
+	}
+
+	void on_add(int entity_id, const Signature& entity_sign) override 
+	{
+		if ((entity_sign & group_sign) != group_sign || contains(entity_id)) 
+		{
+			return;
+		}
+		// Move the entity to the first free slot after the group in every owned pool
+		std::apply([&](auto&... pool) { (pool->swap(pool->index_of(entity_id), size), ...); }, pools);
+		size++;
+	}
+
+	void on_remove(int entity_id) override 
+	{
+		if (!contains(entity_id)) 
+		{
+			return;
+		}
+		// Move the entity to the last slot of the group and shrink the group over it
+		size--;
+		std::apply([&](auto&... pool) { (pool->swap(pool->index_of(entity_id), size), ...); }, pools);
+	}
+
+	bool contains(int entity_id) const 
+	{
+		const auto& lead = std::get<0>(pools);
+		return lead->has(entity_id) && lead->index_of(entity_id) < size;
+	}
+
+	int get_entity_id(int idx) const { return std::get<0>(pools)->entity_at(idx); }
+
+	// Invokes func(Towned&...) for every entity of the group
+	template <typename Tfunc>
+	void each(Tfunc&& func) 
+	{
+		std::apply([&](auto&... pool) {
+			[&](auto*... comps) {
+				for (int i = 0; i < size; i++) 
+				{
+					func(comps[i]...);
+				}
+			}(pool->raw()...);
+		}, pools);
+	}
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // Registry
 ////////////////////////////////////////////////////////////////////////////////
@@ -159,6 +361,12 @@ private:
 	// [Vector index = entity id]
 	std::vector<Signature> entityComponentSignatures;
 
+	// Owning groups, and the group that owns each component type
+	// [Map key = group type id]
+	// [Vector index = component type id]
+	std::unordered_map<std::type_index, std::shared_ptr<Igroup>> groups;
+	std::vector<Igroup*> comp_owners;
+
 	// Map of active systems
 	// [Map key = system type id]
 	std::unordered_map<std::type_index, std::shared_ptr<System>> systems;
@@ -174,7 +382,7 @@ private:
 
 
 	// List of free entity ids that were previously removed
-
+	std::deque<int> free_ids;
 
 public:
 	Registry() { Logger::Log("Registry constructor called"); }
@@ -186,15 +394,28 @@ public:
 
 	// Entity management
 	Entity CreateEntity();
+	void KillEntity(Entity ent);
+	// Entities created and not killed, including the ones waiting for the next update()
+	int GetNumEntities() const { return num_entities - static_cast<int>(free_ids.size()); }
+
+	// World management
+	// A registry is a world: several of them can exist at once and be built on different threads.
+	// Clear() drops every entity but keeps systems and groups, Merge() moves all the entities and
+	// components of another world into this one, leaving the other world empty.
+	void Clear();
+	void Merge(Registry& other);
 
 
 	// Tag management
 
 
 	// Group management
-
+	template <typename ...Towned> void AddGroup();
+	template <typename ...Towned> bool HasGroup() const;
+	template <typename ...Towned> Group<Towned...>& GetGroup() const;
 
 	// Component management
+	template <typename Tcomp> std::shared_ptr<Pool<Tcomp>> GetPool();
 	template <typename Tcomp, typename ...Targs> void AddComponent(Entity ent, Targs&& ...args);
 	template <typename Tcomp> void RemoveComponent(Entity ent);
 	template <typename Tcomp> bool HasComponent(Entity ent) const;
@@ -209,6 +430,7 @@ public:
 	// Checks the component signature of an entity and add or remove the entity to the systems
 	// that are interested in it
 	void AddEntityToSystems(Entity ent);
+	void RemoveEntityFromSystems(Entity ent);
 };
 
 // Template function implementation
@@ -251,16 +473,16 @@ Tsys& Registry::GetSystem() const
 	return *(std::static_pointer_cast<Tsys>(system->second));
 }
 
-template <typename Tcomp, typename ...Targs>
-void Registry::AddComponent(Entity ent, Targs&& ...args) 
+template <typename Tcomp>
+std::shared_ptr<Pool<Tcomp>> Registry::GetPool() 
 {
 	const auto comp_id = Component<Tcomp>::GetId();
-	const auto entity_id = ent.GetId();
 
 	// If the component id is greater than the current size of the componentPools, then resize the vector
-	if (comp_id >= comp_pools.size()) 
+	if (comp_id >= static_cast<int>(comp_pools.size())) 
 	{
 		comp_pools.resize(comp_id + 1, nullptr);    // resizing a vector is very costly it is better to allocate more memory from the getgo!
+		comp_owners.resize(comp_id + 1, nullptr);
 	}
 
 	// If we still don't have a Pool for that component type
@@ -270,24 +492,77 @@ void Registry::AddComponent(Entity ent, Targs&& ...args)
 		comp_pools[comp_id] = new_comp_pool;
 	}
 
-	// Get the pool of component values for that component type
-	std::shared_ptr<Pool<Tcomp>> comp_pool = std::static_pointer_cast<Pool<Tcomp>>(comp_pools[comp_id]);
+	return std::static_pointer_cast<Pool<Tcomp>>(comp_pools[comp_id]);
+}
+
+template <typename ...Towned>
+void Registry::AddGroup() 
+{
+	static_assert(sizeof...(Towned) >= 2, "A group needs at least two component types");
 
-	// If the entity id is greater than the current size of the component pool, then resize the pool
-	if (entity_id >= comp_pool->get_size()) 
+	auto new_group = std::make_shared<Group<Towned...>>(GetPool<Towned>()...);
+
+	// A component can only be kept sorted by one group
+	for (auto comp_id : { Component<Towned>::GetId()... }) 
+	{
+		if (comp_owners[comp_id]) 
+		{
+			Logger::Err("Component id = " + std::to_string(comp_id) + " is already owned by another group");
+			return;
+		}
+	}
+	for (auto comp_id : { Component<Towned>::GetId()... }) 
 	{
-		comp_pool->resize(num_entities);
+		comp_owners[comp_id] = new_group.get();
 	}
+	groups.insert(std::make_pair(std::type_index(typeid(Group<Towned...>)), new_group));
+
+	// Pack the entities that already have all the owned components
+	auto lead_pool = GetPool<typename std::tuple_element<0, std::tuple<Towned...>>::type>();
+	for (int idx = 0; idx < lead_pool->get_size(); idx++) 
+	{
+		const auto entity_id = lead_pool->entity_at(idx);
+		new_group->on_add(entity_id, entityComponentSignatures[entity_id]);
+	}
+}
+
+template <typename ...Towned>
+bool Registry::HasGroup() const 
+{
+	return groups.find(std::type_index(typeid(Group<Towned...>))) != groups.end();
+}
+
+template <typename ...Towned>
+Group<Towned...>& Registry::GetGroup() const 
+{
+	auto group = groups.find(std::type_index(typeid(Group<Towned...>)));
+	return *(std::static_pointer_cast<Group<Towned...>>(group->second));
+}
+
+template <typename Tcomp, typename ...Targs>
+void Registry::AddComponent(Entity ent, Targs&& ...args) 
+{
+	const auto comp_id = Component<Tcomp>::GetId();
+	const auto entity_id = ent.GetId();
+
+	// Get the pool of component values for that component type
+	std::shared_ptr<Pool<Tcomp>> comp_pool = GetPool<Tcomp>();
 
 	// Create a new Component object of the type T, and forward the various parameters to the constructor
 	Tcomp new_comp(std::forward<Targs>(args)...);
 
-	// Add the new component to the component pool list, using the entity id as index
-	comp_pool->set(entity_id, new_comp);
+	// Add the new component to the component pool list, packed at the end of the pool
+	comp_pool->set(entity_id, std::move(new_comp));
 
 	// Finally, change the component signature of the entity and set the component id on the bitset to 1
 	entityComponentSignatures[entity_id].set(comp_id);
 
+	// Let the group that owns this component pull the entity in if it now has all of its components
+	if (comp_owners[comp_id]) 
+	{
+		comp_owners[comp_id]->on_add(entity_id, entityComponentSignatures[entity_id]);
+	}
+
 	Logger::Log("Component id = " + std::to_string(comp_id) + " was added to entity id " + std::to_string(entity_id));
 
 	//std::cout << "COMPONENT ID " << comp_id << " --> POOL SIZE: " << comp_pool->get_size() << std::endl;
@@ -299,7 +574,19 @@ void Registry::RemoveComponent(Entity ent)
 	const auto comp_id = Component<Tcomp>::GetId();
 	const auto entity_id = ent.GetId();
 
+	if (!HasComponent<Tcomp>(ent)) 
+	{
+		return;
+	}
+
+	// Take the entity out of the owning group first so the pool removal happens outside of the group
+	if (comp_owners[comp_id]) 
+	{
+		comp_owners[comp_id]->on_remove(entity_id);
+	}
+
 	// Remove the component from the component list for that entity
+	std::static_pointer_cast<Pool<Tcomp>>(comp_pools[comp_id])->remove(entity_id);
 
 	//Set this component signature for that entity to false
 	entityComponentSignatures[entity_id].set(comp_id, false);
@@ -319,7 +606,7 @@ template <typename Tcomp>
 Tcomp& Registry::GetComponent(Entity ent) const {
 	const auto comp_id = Component<Tcomp>::GetId();
 	const auto entity_id = ent.GetId();
-	auto comp_pool = std::static_pointer_cast<Pool<Tcomp>>(comp_pools[comp_id]);
+	auto comp_pool = static_cast<Pool<Tcomp>*>(comp_pools[comp_id].get());
 	return comp_pool->get(entity_id);
 }
 
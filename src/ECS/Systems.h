@@ -4,11 +4,23 @@
 #include "../ECS/ECS.h"
 #include "../ECS/Components.h"
 #include "../AssetStore/AssetStore.h"
+#include "../Renderer/RenderCommandList.h"
+#include "../Renderer/DebugDraw.h"
+#include "../Renderer/DirtyRegions.h"
+#include "../Renderer/RenderQueue.h"
+#include "../Spatial/SpatialGrid.h"
+#include "../Tilemap/FogOfWar.h"
+#include "../Tilemap/Minimap.h"
+#include "../Tilemap/Parallax.h"
 
 #define SDL_MAIN_HANDLED
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
 
 class MovementSystem : public System 
 {
@@ -19,22 +31,427 @@ public:
         RequireComponent<RigidBodyComponent>();
     }
 
-    void update(double dt) 
+    void update(Registry& registry, double dt) 
+    {
+        // Transform and rigid body are kept packed in the same order by their owning group,
+        // so this is a linear scan over both pools
+        registry.GetGroup<TransformComponent, RigidBodyComponent>().each(
+            [dt](TransformComponent& transform, const RigidBodyComponent& rigidbody) {
+                // Keep the state of the previous step for the render interpolation
+                transform.prev_pos = transform.pos;
+                transform.prev_rot = transform.rot;
+
+                // Update entity position based on its velocity
+                transform.pos.x += rigidbody.vel.x * dt;
+                transform.pos.y += rigidbody.vel.y * dt;
+            });
+    }
+};
+
+class KeyboardControlSystem : public System 
+{
+public:
+    KeyboardControlSystem()
+    {
+        RequireComponent<KeyboardControlledComponent>();
+        RequireComponent<RigidBodyComponent>();
+    }
+
+    void update(const Uint8* key_state) 
+    {
+        for (auto entity : GetSystemEntities()) {
+            const auto& keyboard = entity.GetComponent<KeyboardControlledComponent>();
+            auto& rigidbody = entity.GetComponent<RigidBodyComponent>();
+
+            // WASD sets the velocity, each axis at full speed
+            glm::vec2 dir(0.0f, 0.0f);
+            if (key_state[SDL_SCANCODE_W]) {
+                dir.y -= 1.0f;
+            }
+            if (key_state[SDL_SCANCODE_S]) {
+                dir.y += 1.0f;
+            }
+            if (key_state[SDL_SCANCODE_A]) {
+                dir.x -= 1.0f;
+            }
+            if (key_state[SDL_SCANCODE_D]) {
+                dir.x += 1.0f;
+            }
+            rigidbody.vel = dir * keyboard.speed;
+        }
+    }
+};
+
+class WrapAroundSystem : public System 
+{
+public:
+    WrapAroundSystem()
+    {
+        RequireComponent<TransformComponent>();
+        RequireComponent<WrapAroundComponent>();
+    }
+
+    void update(int width, int height) 
     {
-        // Loop all entities that the system is interested in
         for (auto entity : GetSystemEntities()) {
-            // Update entity position based on its velocity
             auto& transform = entity.GetComponent<TransformComponent>();
-            const auto rigidbody = entity.GetComponent<RigidBodyComponent>();
+            const glm::vec2 before = transform.pos;
+
+            if (transform.pos.x > width) {
+                transform.pos.x = 0;
+            }
+            if (transform.pos.x < 0) {
+                transform.pos.x = width;
+            }
+            if (transform.pos.y > height) {
+                transform.pos.y = 0;
+            }
+            if (transform.pos.y < 0) {
+                transform.pos.y = height;
+            }
 
-            transform.pos.x += rigidbody.vel.x * dt;
-            transform.pos.y += rigidbody.vel.y * dt;
+            // Don't interpolate across the whole screen after a wrap
+            if (transform.pos != before) {
+                transform.prev_pos = transform.pos;
+            }
+        }
+    }
+};
+
+class AnimationSystem : public System 
+{
+public:
+    AnimationSystem()
+    {
+        RequireComponent<AnimationComponent>();
+        RequireComponent<SpriteComponent>();
+    }
+
+    // Animation and sprite are packed in the same order by their owning group.
+    // With a visible_frame stamp, only the sprites drawn in that frame are animated, the others
+    // keep their frame until they come back on screen. 0 animates every entity.
+    void update(Registry& registry, double dt, Uint32 visible_frame = 0) 
+    {
+        const float step = static_cast<float>(dt);
+        registry.GetGroup<AnimationComponent, SpriteComponent>().each(
+            [step, visible_frame](AnimationComponent& animation, SpriteComponent& sprite) {
+                if (!animation.clip || (visible_frame != 0 && sprite.visible_frame != visible_frame)) {
+                    return;
+                }
+
+                const AnimationClip& clip = *animation.clip;
+                const int num_frames = static_cast<int>(clip.frames.size());
+                if (num_frames == 0) {
+                    return;
+                }
+
+                // Advance as many frames as the elapsed time covers, a long step can skip some
+                const int frame = animation.frame;
+                animation.time += step;
+                while (clip.durations[animation.frame] > 0.0f && animation.time >= clip.durations[animation.frame]) {
+                    if (animation.frame + 1 < num_frames) {
+                        animation.time -= clip.durations[animation.frame];
+                        animation.frame++;
+                    } else if (clip.looping) {
+                        animation.time -= clip.durations[animation.frame];
+                        animation.frame = 0;
+                    } else {
+                        animation.time = 0.0f;
+                        break;
+                    }
+                }
+
+                if (animation.frame != frame) {
+                    sprite.src_rect = clip.frames[animation.frame];
+                }
+            });
+    }
+};
+
+class VisionSystem : public System 
+{
+private:
+    struct Viewer 
+    {
+        int col;
+        int row;
+        int radius;
+        bool placed;
+    };
+    // [Vector index = entity id] Disc each viewer last uncovered
+    std::vector<Viewer> viewers;
+    // Discs of the viewers removed since the last update
+    std::vector<Viewer> removed;
+
+    void OnEntityAdded(Entity entity) override 
+    {
+        if (viewers.size() <= static_cast<size_t>(entity.GetId())) {
+            viewers.resize(entity.GetId() + 1);
+        }
+        viewers[entity.GetId()].placed = false;
+    }
+
+    void OnEntityRemoved(Entity entity) override 
+    {
+        Viewer& viewer = viewers[entity.GetId()];
+        if (viewer.placed) {
+            removed.push_back(viewer);
+            viewer.placed = false;
+        }
+    }
+
+    // The fog is reset with the level
+    void OnEntitiesCleared() override 
+    {
+        viewers.clear();
+        removed.clear();
+    }
+
+public:
+    VisionSystem()
+    {
+        RequireComponent<TransformComponent>();
+        RequireComponent<VisionComponent>();
+    }
+
+    // Only the viewers that reached another tile update the fog, and only around them
+    void update(FogOfWar& fog) 
+    {
+        for (const auto& viewer : removed) {
+            fog.remove_viewer(viewer.col, viewer.row, viewer.radius);
+        }
+        removed.clear();
+
+        for (auto entity : GetSystemEntities()) {
+            const auto& transform = entity.GetComponent<TransformComponent>();
+            const int radius = entity.GetComponent<VisionComponent>().radius;
+            const int col = fog.col_at(transform.pos.x);
+            const int row = fog.row_at(transform.pos.y);
+
+            Viewer& viewer = viewers[entity.GetId()];
+            if (!viewer.placed) {
+                fog.add_viewer(col, row, radius);
+            } else if (viewer.radius != radius) {
+                fog.add_viewer(col, row, radius);
+                fog.remove_viewer(viewer.col, viewer.row, viewer.radius);
+            } else {
+                fog.move_viewer(viewer.col, viewer.row, col, row, radius);
+            }
+            viewer = { col, row, radius, true };
+        }
+    }
+};
+
+// Only the entities with a blip are tracked, the minimap never walks the whole world
+class MinimapSystem : public System 
+{
+public:
+    MinimapSystem()
+    {
+        RequireComponent<TransformComponent>();
+        RequireComponent<MinimapBlipComponent>();
+    }
+
+    // The blips are refreshed every few frames, as the minimap asks
+    void update(Minimap& minimap) 
+    {
+        if (!minimap.begin_blips()) {
+            return;
+        }
+        for (auto entity : GetSystemEntities()) {
+            const auto& transform = entity.GetComponent<TransformComponent>();
+            minimap.add_blip(transform.pos.x, transform.pos.y, entity.GetComponent<MinimapBlipComponent>().color);
+        }
+    }
+};
+
+class CameraMovementSystem : public System 
+{
+public:
+    CameraMovementSystem()
+    {
+        RequireComponent<TransformComponent>();
+        RequireComponent<CameraFollowComponent>();
+    }
+
+    // Runs in the render phase with the interpolated position, so the followed entity doesn't jitter
+    void update(SDL_Rect& camera, double alpha, int map_width, int map_height) 
+    {
+        for (auto entity : GetSystemEntities()) {
+            const auto& transform = entity.GetComponent<TransformComponent>();
+            const glm::vec2 pos = glm::mix(transform.prev_pos, transform.pos, static_cast<float>(alpha));
+
+            // Center the camera on the entity without showing anything outside of the map
+            camera.x = static_cast<int>(pos.x) - camera.w / 2;
+            camera.y = static_cast<int>(pos.y) - camera.h / 2;
+            camera.x = std::max(0, std::min(camera.x, map_width - camera.w));
+            camera.y = std::max(0, std::min(camera.y, map_height - camera.h));
         }
     }
 };
 
 class RenderSystem : public System 
 {
+private:
+    // Every sprite is in the grid. Entities that can move (they have a rigid body) or change their
+    // frame (they are animated) are checked every frame, the static ones never are.
+    SpatialGrid grid;
+    std::vector<Entity> dynamic_entities;
+
+    class Registry* reg = nullptr;
+
+    // Reused every frame: the sprites overlapping the camera, drawn in the order of their sort keys
+    struct DrawItem 
+    {
+        SDL_Texture* texture;
+        SDL_Rect src_rect;
+        SDL_FRect dst_rect;
+        double rot;
+    };
+    std::vector<DrawItem> draw_items;
+    RenderQueue queue;
+    // Sprites drawn by the frame, each counted once even when several dirty areas draw it
+    int drawn = 0;
+    // [Vector index = entity id] Stamp of the last frame that counted the sprite as drawn
+    std::vector<Uint32> counted_frames;
+    // The texture lookup is only needed when the asset changes from one sprite to the next
+    const std::string* last_asset_id = nullptr;
+    const TextureRegion* last_region = nullptr;
+    // Written into the sprites drawn by the current frame, never 0
+    Uint32 frame_stamp = 0;
+
+    // Reference path for render regression checks: every entity, no grid, a comparison sort
+    bool naive = false;
+    const Parallax* parallax = nullptr;
+    std::vector<std::pair<uint32_t, uint32_t>> naive_order;
+
+    // What each sprite covered when it was last drawn, in world pixels, for the dirty rectangle mode.
+    // Rotated sprites cover the square their rotation can reach.
+    struct Footprint 
+    {
+        SDL_Rect rect;
+        SDL_Rect src_rect;
+        float rot;
+
+        bool operator==(const Footprint& other) const 
+        {
+            return rect.x == other.rect.x && rect.y == other.rect.y && rect.w == other.rect.w && rect.h == other.rect.h && 
+                src_rect.x == other.src_rect.x && src_rect.y == other.src_rect.y && 
+                src_rect.w == other.src_rect.w && src_rect.h == other.src_rect.h && rot == other.rot;
+        }
+    };
+    // Only kept in the dirty rectangle mode, nothing else reads them
+    bool dirty_mode = false;
+    // [Vector index = entity id]
+    std::vector<Footprint> footprints;
+    // Areas left by the sprites added and removed since the last frame
+    std::vector<SDL_Rect> pending_dirty;
+    bool pending_full = true;
+
+    // Sort key, from the most significant bits: layer (8), texture (8), bottom edge on screen (16).
+    // Sprites with the same key are drawn in the order the grid returns them.
+    static uint32_t sort_key(int z_index, int texture_index, float bottom) 
+    {
+        const uint32_t layer = static_cast<uint32_t>(std::min(std::max(z_index + 128, 0), 255));
+        const uint32_t texture = static_cast<uint32_t>(texture_index) & 0xFF;
+        const uint32_t y = static_cast<uint32_t>(std::min(std::max(static_cast<int>(bottom) + 32768, 0), 65535));
+        return (layer << 24) | (texture << 16) | y;
+    }
+
+    static SDL_FRect world_rect(const glm::vec2& pos, const TransformComponent& transform, const SpriteComponent& sprite) 
+    {
+        return {
+            pos.x,
+            pos.y,
+            static_cast<float>(static_cast<int>(sprite.width * transform.scale.x)),
+            static_cast<float>(static_cast<int>(sprite.height * transform.scale.y))
+        };
+    }
+
+    static Footprint footprint(const glm::vec2& pos, double rot, const TransformComponent& transform, const SpriteComponent& sprite) 
+    {
+        // Snapped like the destination rectangles, plus a pixel for the edges of the rasterizer
+        const SDL_FRect rect = world_rect(pos, transform, sprite);
+        SDL_Rect area = { static_cast<int>(pos.x), static_cast<int>(pos.y), static_cast<int>(rect.w), static_cast<int>(rect.h) };
+        if (rot != 0.0) 
+        {
+            const int side = static_cast<int>(std::ceil(std::sqrt(rect.w * rect.w + rect.h * rect.h)));
+            area = { area.x + (area.w - side) / 2, area.y + (area.h - side) / 2, side, side };
+        }
+        area = { area.x - 1, area.y - 1, area.w + 2, area.h + 2 };
+        return { area, sprite.src_rect, static_cast<float>(rot) };
+    }
+
+    // Records where the sprite is now, returns the area it covers
+    SDL_Rect track_footprint(Entity entity) 
+    {
+        const auto& transform = entity.GetComponent<TransformComponent>();
+        if (footprints.size() <= static_cast<size_t>(entity.GetId())) {
+            footprints.resize(entity.GetId() + 1);
+        }
+        footprints[entity.GetId()] = footprint(transform.pos, transform.rot, transform, entity.GetComponent<SpriteComponent>());
+        return footprints[entity.GetId()].rect;
+    }
+
+    void place_in_grid(Entity entity) 
+    {
+        const auto& transform = entity.GetComponent<TransformComponent>();
+        const auto& sprite = entity.GetComponent<SpriteComponent>();
+        const SDL_FRect rect = world_rect(transform.pos, transform, sprite);
+        grid.update(entity.GetId(), rect.x, rect.y, rect.w, rect.h);
+    }
+
+    // Starts a frame: moves the entities that changed cell since the last one, and stamps it
+    void begin_frame() 
+    {
+        for (auto entity : dynamic_entities) {
+            place_in_grid(entity);
+        }
+        if (++frame_stamp == 0) {
+            frame_stamp = 1;
+        }
+        drawn = 0;
+        last_asset_id = nullptr;
+    }
+
+protected:
+    void OnEntityAdded(Entity entity) override 
+    {
+        reg = entity.reg;
+        place_in_grid(entity);
+        if (entity.HasComponent<RigidBodyComponent>() || entity.HasComponent<AnimationComponent>()) {
+            dynamic_entities.push_back(entity);
+        }
+
+        if (dirty_mode) {
+            pending_dirty.push_back(track_footprint(entity));
+        }
+    }
+
+    void OnEntityRemoved(Entity entity) override 
+    {
+        grid.remove(entity.GetId());
+        for (size_t i = 0; i < dynamic_entities.size(); i++) {
+            if (dynamic_entities[i] == entity) {
+                dynamic_entities[i] = dynamic_entities.back();
+                dynamic_entities.pop_back();
+                break;
+            }
+        }
+        if (dirty_mode) {
+            pending_dirty.push_back(footprints[entity.GetId()].rect);
+        }
+    }
+
+    void OnEntitiesCleared() override 
+    {
+        grid.clear();
+        dynamic_entities.clear();
+        pending_dirty.clear();
+        pending_full = true;
+        counted_frames.clear();
+    }
+
 public:
     RenderSystem() 
     {
@@ -42,33 +459,251 @@ public:
         RequireComponent<SpriteComponent>();
     }
 
-    void update(SDL_Renderer* renderer, std::unique_ptr<AssetStore>& asset_store) {
-        // Loop all entities that the system is interested in
-        for (auto entity : GetSystemEntities()) {
+    // Only the sprites overlapping the camera are drawn, the cost follows the number of visible entities
+    // alpha is how far the render time is between the previous and the current simulation step
+    // The sprites are recorded into the command list, the render thread draws them
+    void update(RenderCommandList& commands, std::unique_ptr<AssetStore>& asset_store, const SDL_Rect& camera, double alpha = 1.0) {
+        begin_frame();
+
+        if (naive) {
+            draw_items.clear();
+            queue.clear();
+            collect_parallax(camera);
+            for (auto entity : GetSystemEntities()) {
+                collect(asset_store, entity.GetId(), camera, camera, alpha, false);
+            }
+            naive_order.clear();
+            for (size_t i = 0; i < queue.size(); i++) {
+                naive_order.emplace_back(queue.get_key(i), queue.get_item(i));
+            }
+            std::stable_sort(naive_order.begin(), naive_order.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+            for (const auto& entry : naive_order) {
+                const DrawItem& item = draw_items[entry.second];
+                commands.draw(item.texture, item.src_rect, item.dst_rect, item.rot);
+            }
+            return;
+        }
+
+        draw_area(commands, asset_store, camera, camera, alpha);
+    }
+
+    // Dirty rectangle mode, replaces update(): starts the frame and adds the world areas that changed
+    // since the last one, where the sprites were and where they are now. Then draw_area() redraws each of them.
+    void collect_dirty(const SDL_Rect& camera, double alpha, DirtyRegions& dirty) 
+    {
+        begin_frame();
+
+        if (pending_full) {
+            dirty.invalidate();
+            pending_full = false;
+        }
+        for (const auto& rect : pending_dirty) {
+            dirty.add(rect);
+        }
+        pending_dirty.clear();
+
+        for (auto entity : dynamic_entities) {
             const auto& transform = entity.GetComponent<TransformComponent>();
-            const auto sprite = entity.GetComponent<SpriteComponent>();
+            auto& sprite = entity.GetComponent<SpriteComponent>();
+            const glm::vec2 pos = glm::mix(transform.prev_pos, transform.pos, static_cast<float>(alpha));
+            const double rot = transform.prev_rot + (transform.rot - transform.prev_rot) * alpha;
+
+            const Footprint now = footprint(pos, rot, transform, sprite);
+            Footprint& last = footprints[entity.GetId()];
+            if (!(now == last)) {
+                dirty.add(last.rect);
+                dirty.add(now.rect);
+                last = now;
+            }
+
+            // Animated sprites on screen keep animating even when nothing around them is redrawn
+            if (SDL_HasIntersection(&now.rect, &camera)) {
+                sprite.visible_frame = frame_stamp;
+            }
+        }
+    }
+
+    // Draws the sprites overlapping area, in world space, at their position relative to the camera
+    void draw_area(RenderCommandList& commands, std::unique_ptr<AssetStore>& asset_store, const SDL_Rect& camera, const SDL_Rect& area, double alpha = 1.0) 
+    {
+        draw_items.clear();
+        queue.clear();
+        collect_parallax(camera);
+        grid.query(area, [&](int entity_id) {
+            collect(asset_store, entity_id, camera, area, alpha, true);
+        });
+        queue.sort();
+
+        // Consecutive sprites sharing a texture are submitted together, so the number of
+        // draw calls depends on the texture changes and not on the number of entities
+        for (size_t i = 0; i < queue.size(); i++) {
+            const DrawItem& item = draw_items[queue.get_item(i)];
+            commands.draw(item.texture, item.src_rect, item.dst_rect, item.rot);
+        }
+    }
 
+    // Lines of the grid cells, the bounds of the sprites overlapping the camera,
+    // where the moving ones are heading and the area the rotated ones may cover
+    void draw_debug(DebugDraw& debug, const SDL_Rect& camera) 
+    {
+        const int cell_size = grid.get_cell_size();
+        const SDL_Color grid_color = { 80, 80, 80, 255 };
+        for (int x = camera.x - ((camera.x % cell_size) + cell_size) % cell_size; x <= camera.x + camera.w; x += cell_size) {
+            debug.line(static_cast<float>(x), static_cast<float>(camera.y), static_cast<float>(x), static_cast<float>(camera.y + camera.h), grid_color);
+        }
+        for (int y = camera.y - ((camera.y % cell_size) + cell_size) % cell_size; y <= camera.y + camera.h; y += cell_size) {
+            debug.line(static_cast<float>(camera.x), static_cast<float>(y), static_cast<float>(camera.x + camera.w), static_cast<float>(y), grid_color);
+        }
 
+        grid.query(camera, [&](int entity_id) {
+            Entity entity(entity_id);
+            entity.reg = reg;
+            const auto& transform = entity.GetComponent<TransformComponent>();
+            const SDL_FRect rect = world_rect(transform.pos, transform, entity.GetComponent<SpriteComponent>());
+            if (rect.x + rect.w < camera.x || rect.x > camera.x + camera.w || 
+                rect.y + rect.h < camera.y || rect.y > camera.y + camera.h) {
+                return;
+            }
 
-            // Set the source rectangle of our original sprite texture
-            SDL_Rect src_rect = sprite.src_rect;
+            const bool moving = entity.HasComponent<RigidBodyComponent>();
+            debug.rect(rect, moving ? SDL_Color{ 255, 220, 0, 255 } : SDL_Color{ 0, 200, 0, 255 });
+            const float center_x = rect.x + rect.w / 2;
+            const float center_y = rect.y + rect.h / 2;
+            if (moving) {
+                // One second ahead
+                const glm::vec2& vel = entity.GetComponent<RigidBodyComponent>().vel;
+                debug.line(center_x, center_y, center_x + vel.x, center_y + vel.y, { 0, 160, 255, 255 });
+            }
+            if (transform.rot != 0.0) {
+                debug.circle(center_x, center_y, std::sqrt(rect.w * rect.w + rect.h * rect.h) / 2, { 255, 0, 255, 255 });
+            }
+        });
+    }
 
-            // Set the destination rectangle of
-            SDL_Rect dst_rect = {
-                static_cast<int>(transform.pos.x),
-                static_cast<int>(transform.pos.y),
-                static_cast<int>(sprite.width * transform.scale.x),
-                static_cast<int>(sprite.height * transform.scale.y)
-            };
+    // Sprites drawn by the last update, the others were culled
+    int get_drawn() const { return drawn; }
 
-            SDL_RenderCopyEx(renderer, asset_store->get_texture(sprite.asset_id), &src_rect, &dst_rect, transform.rot, NULL, SDL_FLIP_NONE);
+    // Stamp of the last update, the animation system only advances the sprites carrying it
+    Uint32 get_frame_stamp() const { return frame_stamp; }
 
-            //SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-            //SDL_RenderFillRect(renderer, &obj_rect);
+    void set_naive(bool naive) { this->naive = naive; }
 
-            // Draw a PNG texture
+    // Dirty rectangle mode, where collect_dirty() replaces update()
+    void set_dirty(bool dirty) 
+    {
+        if (dirty && !dirty_mode) {
+            for (auto entity : GetSystemEntities()) {
+                track_footprint(entity);
+            }
+            pending_full = true;
+        }
+        dirty_mode = dirty;
+        if (!dirty_mode) {
+            footprints.clear();
+            pending_dirty.clear();
+        }
+    }
+
+    // Layers drawn over the whole view, between the sprites of lower and higher z_index
+    void set_parallax(const Parallax* parallax) { this->parallax = parallax; }
+
+private:
+    // One draw item per parallax layer, sorted before the sprites that share its z_index
+    void collect_parallax(const SDL_Rect& camera) 
+    {
+        if (!parallax) {
+            return;
+        }
+        for (int layer = 0; layer < parallax->get_layer_count(); layer++) {
+            const ParallaxDraw draw = parallax->get_draw(layer, camera);
+            if (!draw.texture) {
+                continue;
+            }
+            DrawItem item;
+            item.texture = draw.texture;
+            item.src_rect = draw.src_rect;
+            item.dst_rect = { 0.0f, 0.0f, static_cast<float>(draw.src_rect.w), static_cast<float>(draw.src_rect.h) };
+            item.rot = 0.0;
+            queue.push(sort_key(draw.z_index, 0, -32768.0f), static_cast<uint32_t>(draw_items.size()));
+            draw_items.push_back(item);
         }
     }
+
+    // Adds the sprite to the draw items with its sort key, unless cull is set and it is outside of area
+    void collect(std::unique_ptr<AssetStore>& asset_store, int entity_id, const SDL_Rect& camera, const SDL_Rect& area, double alpha, bool cull) 
+    {
+        Entity entity(entity_id);
+        entity.reg = reg;
+        const auto& transform = entity.GetComponent<TransformComponent>();
+        auto& sprite = entity.GetComponent<SpriteComponent>();
+
+        const glm::vec2 pos = glm::mix(transform.prev_pos, transform.pos, static_cast<float>(alpha));
+        const double rot = transform.prev_rot + (transform.rot - transform.prev_rot) * alpha;
+
+        // The grid returns the candidates of the overlapping cells, skip the ones outside of the area
+        const SDL_FRect rect = world_rect(pos, transform, sprite);
+        if (cull && (rect.x + rect.w < area.x || rect.x > area.x + area.w || 
+            rect.y + rect.h < area.y || rect.y > area.y + area.h)) {
+            return;
+        }
+
+        // Small images share atlas pages, the sprite rectangle is relative to the image region
+        if (!last_asset_id || *last_asset_id != sprite.asset_id) {
+            last_region = asset_store->get_texture_region(sprite.asset_id);
+            last_asset_id = &sprite.asset_id;
+        }
+        const TextureRegion* region = last_region;
+        if (!region) {
+            return;
+        }
+        sprite.visible_frame = frame_stamp;
+        if (counted_frames.size() <= static_cast<size_t>(entity_id)) {
+            counted_frames.resize(entity_id + 1, 0);
+        }
+        if (counted_frames[entity_id] != frame_stamp) {
+            counted_frames[entity_id] = frame_stamp;
+            drawn++;
+        }
+
+        // Set the destination rectangle in screen space, snapped to whole pixels
+        DrawItem item;
+        item.texture = region->texture;
+        item.src_rect = {
+            region->rect.x + sprite.src_rect.x,
+            region->rect.y + sprite.src_rect.y,
+            sprite.src_rect.w,
+            sprite.src_rect.h
+        };
+        item.dst_rect = {
+            static_cast<float>(static_cast<int>(pos.x) - camera.x),
+            static_cast<float>(static_cast<int>(pos.y) - camera.y),
+            rect.w,
+            rect.h
+        };
+        item.rot = rot;
+
+        // A copy already scaled and turned is drawn 1:1, centred where the transformed sprite would be
+        int texture_index = region->texture_index;
+        if (!naive && sprite.src_rect.w > 0 && sprite.src_rect.h > 0) {
+            const ScaledVariant* variant = asset_store->get_scaled_variant(*region, 
+                rect.w / sprite.src_rect.w, rect.h / sprite.src_rect.h, rot);
+            if (variant) {
+                item.texture = variant->region.texture;
+                item.src_rect = variant->map_rect(sprite.src_rect);
+                item.dst_rect = {
+                    item.dst_rect.x + static_cast<int>(rect.w - item.src_rect.w) / 2,
+                    item.dst_rect.y + static_cast<int>(rect.h - item.src_rect.h) / 2,
+                    static_cast<float>(item.src_rect.w),
+                    static_cast<float>(item.src_rect.h)
+                };
+                item.rot = 0.0;
+                texture_index = variant->region.texture_index;
+            }
+        }
+
+        queue.push(sort_key(sprite.z_index, texture_index, item.dst_rect.y + item.dst_rect.h), static_cast<uint32_t>(draw_items.size()));
+        draw_items.push_back(item);
+    }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,36 @@
+#include "EventBus.h"
+#include "../Logger/Logger.h"
+
+int Ievent::next_id = 0;     // class' static fields have to be initialized
+
+EventBus::EventBus() 
+{
+	Logger::Log("EventBus constructor called!");
+}
+
+EventBus::~EventBus() 
+{
+	Logger::Log("EventBus destructor called!");
+}
+
+void EventBus::DispatchQueuedEvents() 
+{
+	for (auto& queue : queues) 
+	{
+		if (queue) 
+		{
+			queue->dispatch();
+		}
+	}
+}
+
+void EventBus::ClearQueuedEvents() 
+{
+	for (auto& queue : queues) 
+	{
+		if (queue) 
+		{
+			queue->clear();
+		}
+	}
+}
@@ -0,0 +1,217 @@
+#ifndef EVENTBUS_H
+#define EVENTBUS_H
+
+#include <vector>
+#include <memory>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////////////////
+// Event
+////////////////////////////////////////////////////////////////////////////////
+// Any struct can be an event, this only gives every event type a unique id
+////////////////////////////////////////////////////////////////////////////////
+struct Ievent 
+{
+protected:
+	static int next_id;
+};
+
+template <typename T>
+class Event : public Ievent 
+{
+public:
+	// Returns the unique id of Event<T>
+	static int GetId() {
+		static auto id = next_id++;
+		return id;
+	}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// EventQueue
+////////////////////////////////////////////////////////////////////////////////
+// One queue per event type. Queued events are stored by value in a vector and
+// subscribers in a flat array of (owner, function pointer), so once the vectors
+// have grown to the frame's peak nothing is allocated anymore.
+////////////////////////////////////////////////////////////////////////////////
+class Iqueue 
+{
+public:
+	virtual ~Iqueue() = default;
+	virtual void dispatch() = 0;
+	virtual void clear() = 0;
+};
+
+template <typename Tevent>
+class EventQueue : public Iqueue 
+{
+private:
+	struct Subscriber 
+	{
+		void* owner;
+		void (*callback)(void* owner, Tevent& event);
+	};
+
+	std::vector<Subscriber> subscribers;
+	// Handlers can unsubscribe while an event is being delivered. Their entries
+	// get a null callback and are only removed once no emit() is running.
+	int emitting = 0;
+	bool has_removed = false;
+
+	// Handlers can queue new events while the queued ones are being delivered,
+	// those go to the pending vector and wait for the next dispatch
+	std::vector<Tevent> pending;
+	std::vector<Tevent> dispatching;
+
+	void remove_unsubscribed() 
+	{
+		for (size_t i = 0; i < subscribers.size(); i++) 
+		{
+			if (!subscribers[i].callback) 
+			{
+				subscribers[i] = subscribers.back();
+				subscribers.pop_back();
+				i--;
+			}
+		}
+		has_removed = false;
+	}
+
+public:
+	void subscribe(void* owner, void (*callback)(void*, Tevent&)) { subscribers.push_back({ owner, callback }); }
+
+	void unsubscribe(void* owner) 
+	{
+		for (auto& subscriber : subscribers) 
+		{
+			if (subscriber.owner == owner) 
+			{
+				subscriber.callback = nullptr;
+				has_removed = true;
+			}
+		}
+		if (emitting == 0) 
+		{
+			remove_unsubscribed();
+		}
+	}
+
+	// Subscribers added by a handler only get the next events
+	void emit(Tevent& event) 
+	{
+		emitting++;
+		const size_t count = subscribers.size();
+		for (size_t i = 0; i < count; i++) 
+		{
+			if (subscribers[i].callback) 
+			{
+				subscribers[i].callback(subscribers[i].owner, event);
+			}
+		}
+		emitting--;
+
+		if (emitting == 0 && has_removed) 
+		{
+			remove_unsubscribed();
+		}
+	}
+
+	template <typename ...Targs>
+	void enqueue(Targs&& ...args) { pending.emplace_back(std::forward<Targs>(args)...); }
+
+	int get_size() const { return pending.size(); }
+
+	void dispatch() override 
+	{
+		std::swap(pending, dispatching);
+		for (auto& event : dispatching) 
+		{
+			emit(event);
+		}
+		dispatching.clear();
+	}
+
+	void clear() override 
+	{
+		pending.clear();
+		dispatching.clear();
+	}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// EventBus
+////////////////////////////////////////////////////////////////////////////////
+// Events are either emitted (delivered right away) or queued and delivered in
+// a batch when DispatchQueuedEvents() is called at a fixed phase of the frame.
+////////////////////////////////////////////////////////////////////////////////
+class EventBus 
+{
+private:
+	// [Vector index = event type id]
+	std::vector<std::unique_ptr<Iqueue>> queues;
+
+	template <typename Tevent> EventQueue<Tevent>& GetQueue();
+
+public:
+	EventBus();
+	~EventBus();
+
+	// Subscribes a member function, e.g. SubscribeToEvent<KeyPressedEvent, &Game::on_key_pressed>(this)
+	template <typename Tevent, auto Callback, typename Towner> void SubscribeToEvent(Towner* owner);
+	template <typename Tevent, typename Towner> void UnsubscribeFromEvent(Towner* owner);
+
+	// Delivers the event to the subscribers right away
+	template <typename Tevent, typename ...Targs> void EmitEvent(Targs&& ...args);
+
+	// Stores the event until the next DispatchQueuedEvents()
+	template <typename Tevent, typename ...Targs> void QueueEvent(Targs&& ...args);
+
+	void DispatchQueuedEvents();
+	void ClearQueuedEvents();
+};
+
+template <typename Tevent>
+EventQueue<Tevent>& EventBus::GetQueue() 
+{
+	const auto event_id = Event<Tevent>::GetId();
+
+	if (event_id >= static_cast<int>(queues.size())) 
+	{
+		queues.resize(event_id + 1);
+	}
+	if (!queues[event_id]) 
+	{
+		queues[event_id] = std::make_unique<EventQueue<Tevent>>();
+	}
+	return *static_cast<EventQueue<Tevent>*>(queues[event_id].get());
+}
+
+template <typename Tevent, auto Callback, typename Towner>
+void EventBus::SubscribeToEvent(Towner* owner) 
+{
+	// A non capturing lambda decays to a plain function pointer, no std::function allocation
+	GetQueue<Tevent>().subscribe(owner, [](void* instance, Tevent& event) {
+		(static_cast<Towner*>(instance)->*Callback)(event);
+	});
+}
+
+template <typename Tevent, typename Towner>
+void EventBus::UnsubscribeFromEvent(Towner* owner) 
+{
+	GetQueue<Tevent>().unsubscribe(owner);
+}
+
+template <typename Tevent, typename ...Targs>
+void EventBus::EmitEvent(Targs&& ...args) 
+{
+	Tevent event(std::forward<Targs>(args)...);
+	GetQueue<Tevent>().emit(event);
+}
+
+template <typename Tevent, typename ...Targs>
+void EventBus::QueueEvent(Targs&& ...args) 
+{
+	GetQueue<Tevent>().enqueue(std::forward<Targs>(args)...);
+}
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef KEYPRESSEDEVENT_H
+#define KEYPRESSEDEVENT_H
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+struct KeyPressedEvent 
+{
+	SDL_Keycode symbol;
+
+	KeyPressedEvent(SDL_Keycode symbol = 0) : symbol{ symbol } {}
+};
+
+#endif
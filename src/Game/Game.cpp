@@ -3,24 +3,32 @@
 #include "../ECS/ECS.h"
 #include "../ECS/Components.h"
 #include "../ECS/Systems.h"
+#include "../EventBus/EventBus.h"
+#include "../Events/KeyPressedEvent.h"
 
 
 // lib
 
 
 #include <glm/glm.hpp>
-//#include <imgui/imgui.h>
-//#include <imgui/imgui_sdl.h>
-//#include <imgui/imgui_impl_sdl.h>
 
 //std
 #include <iostream>
 #include <cstdio>
 #include <string>
-#include <fstream>
+#include <chrono>
 
 int Game::windowWidth;
 int Game::windowHeight;
+int Game::mapWidth;
+int Game::mapHeight;
+
+// Tilemap of the levels
+static const int TILE_SIZE = 32;
+static const double TILE_SCALE = 2.0;
+static const int MAP_NUM_COLS = 25;
+static const int MAP_NUM_ROWS = 20;
+static const int MINIMAP_SIZE = 200;
 
 
 Game::Game() 
@@ -28,6 +36,12 @@ Game::Game()
     quit = false;
     registry = std::make_unique<Registry>();
     assetStore = std::make_unique<AssetStore>();
+    eventBus = std::make_unique<EventBus>();
+    explosions.set_speed(40.0f, 250.0f);
+    explosions.set_gravity(150.0f);
+    minimap.set_radar("radar-image");
+    parallax.add_layer("tree-image", 1.25f, 3.0f, 200, 160, 1);
+    hud_panel.set_rect({ 4, 4, 100, 30 });
     Logger::Log("Game constructor called!");
 }
 
@@ -38,9 +52,36 @@ Game::~Game()
 }
 
 
+void Game::set_headless(bool headless)
+{
+    this->headless = headless;
+}
+
+
+void Game::set_max_frames(int frames)
+{
+    max_frames = frames;
+}
+
+
+void Game::set_naive_render(bool naive)
+{
+    naive_render = naive;
+    render_thread.set_batched(!naive);
+}
+
+
+void Game::set_dirty_render(bool dirty)
+{
+    dirty_render = dirty;
+}
+
+
 void Game::initialize() 
 {
-    if (SDL_Init(SDL_INIT_EVERYTHING) != 0) 
+    // Headless runs happen on machines without a display or a sound card
+    const Uint32 subsystems = headless ? (SDL_INIT_TIMER | SDL_INIT_EVENTS) : SDL_INIT_EVERYTHING;
+    if (SDL_Init(subsystems) != 0) 
     {
         Logger::Err("Error initializing SDL.");
         return;
@@ -50,299 +91,622 @@ void Game::initialize()
         Logger::Err("Error initializing SDL TTF.");
         return;
     }
-    if (Mix_Init(MIX_INIT_OGG) == 0) 
-    {
-        Logger::Err("Error initializing SDL Mix");
-        return;
-    }
 
-    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) == -1) 
+    // The game runs without sound when the audio can't be opened
+    if (!headless) 
     {
-        Logger::Err("Error initializing SDL Mix OpenAudio");
-        return;
+        if (Mix_Init(MIX_INIT_OGG) == 0) 
+        {
+            Logger::War("Error initializing SDL Mix, running without audio");
+        }
+        else if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) == -1) 
+        {
+            Logger::War("Error initializing SDL Mix OpenAudio, running without audio");
+        }
+        else 
+        {
+            audio_enabled = true;
+        }
     }
 
-    SDL_DisplayMode display_mode;
-    SDL_GetCurrentDisplayMode(0, &display_mode);
-    windowWidth = display_mode.w;
-    windowHeight = display_mode.h;
-    window = SDL_CreateWindow(
-        "2D game engine", //NULL,
-        SDL_WINDOWPOS_CENTERED,
-        SDL_WINDOWPOS_CENTERED,
-        windowWidth / 2,
-        windowHeight / 2,
-        SDL_WINDOW_SHOWN//SDL_WINDOW_ALLOW_HIGHDPI//SDL_WINDOW_BORDERLESS
-    );
-    if (!window) 
+    bool renderer_created = false;
+    if (headless) 
     {
-        Logger::Err("Error creating SDL window.");
-        return;
+        // Software renderer drawing into a surface, there is no vsync to wait for
+        windowWidth = HEADLESS_WIDTH;
+        windowHeight = HEADLESS_HEIGHT;
+        headless_surface = SDL_CreateRGBSurfaceWithFormat(0, windowWidth, windowHeight, 32, SDL_PIXELFORMAT_ARGB8888);
+        if (!headless_surface) 
+        {
+            Logger::Err("Error creating the headless surface.");
+            return;
+        }
+        renderer_created = render_thread.start([this]() {
+            return SDL_CreateSoftwareRenderer(headless_surface);
+        });
     }
+    else 
+    {
+        SDL_DisplayMode display_mode;
+        SDL_GetCurrentDisplayMode(0, &display_mode);
+        windowWidth = display_mode.w;
+        windowHeight = display_mode.h;
+        window = SDL_CreateWindow(
+            "2D game engine", //NULL,
+            SDL_WINDOWPOS_CENTERED,
+            SDL_WINDOWPOS_CENTERED,
+            windowWidth / 2,
+            windowHeight / 2,
+            SDL_WINDOW_SHOWN//SDL_WINDOW_ALLOW_HIGHDPI//SDL_WINDOW_BORDERLESS
+        );
+        if (!window) 
+        {
+            Logger::Err("Error creating SDL window.");
+            return;
+        }
 
-    renderer = SDL_CreateRenderer(
-        window, 
-        -1, 
-        SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);  
-    if (!renderer) 
+        renderer_created = render_thread.start([this]() {
+            return SDL_CreateRenderer(
+                window, 
+                -1, 
+                SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+        });
+    }
+    if (!renderer_created) 
     {
         Logger::Err("Error creating SDL renderer.");
         return;
     }
     //SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN);
 
-    // Initialize the ImGui context
-    //ImGui::CreateContext();
-    //ImGuiSDL::Initialize(renderer, windowWidth, windowHeight);
 
   
     // Initialize the camera view with the entire screen area
-    //camera.x = 0;
-    //camera.y = 0;
-    //camera.w = windowWidth;
-    //camera.h = windowHeight;
+    int output_width, output_height;
+    render_thread.invoke([&](SDL_Renderer* renderer) {
+        SDL_GetRendererOutputSize(renderer, &output_width, &output_height);
+    });
+    camera.x = 0;
+    camera.y = 0;
+    camera.w = output_width;
+    camera.h = output_height;
+
+    // The world drawn by the previous frames stays in this texture in dirty rectangle mode
+    if (dirty_render && !naive_render) 
+    {
+        render_thread.invoke([this](SDL_Renderer* renderer) {
+            backbuffer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, camera.w, camera.h);
+            if (backbuffer) {
+                SDL_SetTextureBlendMode(backbuffer, SDL_BLENDMODE_NONE);
+            }
+        });
+        if (!backbuffer) 
+        {
+            Logger::War("Error creating the backbuffer, redrawing everything every frame");
+        }
+    }
+
+    render_thread.invoke([this](SDL_Renderer* renderer) {
+        hud_panel.create_texture(renderer);
+    });
+
+    // The overlay is drawn in output pixels, over the frame
+    perf_overlay.initialize(camera.w, camera.h);
+    render_thread.invoke([this](SDL_Renderer* renderer) {
+        perf_overlay.create_font_texture(renderer);
+    });
 }
 
 
 
 void Game::LoadLevel(int level)
 {
-    glm::vec2 p = glm::vec2(10.0, 20.0);
-    glm::vec2 p1 = glm::vec2(100.0, 20.0);
-     
     // Add the systems that need to be processed in our game
     registry->AddSystem<MovementSystem>();
     registry->AddSystem<RenderSystem>();
+    registry->GetSystem<RenderSystem>().set_naive(naive_render);
+    registry->GetSystem<RenderSystem>().set_dirty(backbuffer != nullptr);
+    registry->GetSystem<RenderSystem>().set_parallax(&parallax);
+    registry->AddSystem<KeyboardControlSystem>();
+    registry->AddSystem<WrapAroundSystem>();
+    registry->AddSystem<CameraMovementSystem>();
+    registry->AddSystem<AnimationSystem>();
+    registry->AddSystem<VisionSystem>();
+    registry->AddSystem<MinimapSystem>();
+
+    // Keep the components the movement and animation systems iterate together packed in the same order
+    registry->AddGroup<TransformComponent, RigidBodyComponent>();
+    registry->AddGroup<AnimationComponent, SpriteComponent>();
+
+    LoadLevelAssets(level);
+    tilemap = std::make_unique<Tilemap>();
+    BuildLevel(*registry, *tilemap, level);
+    fog.resize(MAP_NUM_COLS, MAP_NUM_ROWS, static_cast<float>(TILE_SIZE * TILE_SCALE));
+    render_thread.invoke([this](SDL_Renderer* renderer) {
+        tilemap->create_chunks(renderer, camera.w, camera.h);
+        fog.create_texture(renderer);
+        minimap.create_texture(renderer, *tilemap, MINIMAP_SIZE);
+        parallax.create_textures(renderer, *assetStore, camera.w, camera.h);
+    });
+    mapWidth = tilemap->get_width();
+    mapHeight = tilemap->get_height();
+    current_level = level;
+}
 
-    // Adding assets to the asset store
-    assetStore->add_texture(renderer, "tank-image", "./assets/images/tank-panther-right.png");
-    assetStore->add_texture(renderer, "truck-image", "./assets/images/truck-ford-right.png");
-    assetStore->add_texture(renderer, "tilemap-image", "./assets/tilemaps/jungle.png");
 
-    // Load the tilemap
-    int tileSize = 32;
-    double tileScale = 2.0;
-    int mapNumCols = 25;
-    int mapNumRows = 20;
+void Game::LoadLevelAssets(int level)
+{
+    // Adding assets to the asset store, the textures are created on the render thread
+    render_thread.invoke([this](SDL_Renderer* renderer) {
+        assetStore->add_texture(renderer, "tank-image", "./assets/images/tank-panther-right.png");
+        assetStore->add_texture(renderer, "truck-image", "./assets/images/truck-ford-right.png");
+        assetStore->add_texture(renderer, "tank-tiger-image", "./assets/images/tank-tiger-right.png");
+        assetStore->add_texture(renderer, "chopper-image", "./assets/images/chopper-spritesheet.png");
+        assetStore->add_texture(renderer, "tilemap-image", "./assets/tilemaps/jungle.png");
+        assetStore->add_texture(renderer, "radar-image", "./assets/images/radar.png");
+        assetStore->add_texture(renderer, "tree-image", "./assets/images/tree.png");
+
+        // The unit sprites are small, they end up on a shared atlas page
+        assetStore->pack_atlas(renderer);
+    });
+}
 
-    std::fstream mapFile;
-    mapFile.open("./assets/tilemaps/jungle.map");
 
-    for (int y = 0; y < mapNumRows; y++)
-    {
-        for (int x = 0; x < mapNumCols; x++)
-        {
-            char ch;
-            mapFile.get(ch);
-            int srcRectY = std::atoi(&ch) * tileSize;
-            mapFile.get(ch);
-            int srcRectX = std::atoi(&ch) * tileSize;
-            mapFile.ignore();
-
-            Entity tile = registry->CreateEntity();
-            tile.AddComponent<TransformComponent>(glm::vec2(x * (tileScale * tileSize), y * (tileScale * tileSize)), glm::vec2(tileScale, tileScale), 0.0); 
-            tile.AddComponent<SpriteComponent>("tilemap-image", tileSize, tileSize, srcRectX, srcRectY);
-        }   
-    }
-    mapFile.close();
+void Game::BuildLevel(Registry& world, Tilemap& tilemap, int level)
+{
+    // Clips are shared by every entity playing them, and read only once built
+    static const AnimationClip chopper_clip = AnimationClip::FromStrip(0, 0, 32, 32, 2, 1.0f / 15.0f);
+
+    // The tiles are not entities, they are baked into the chunks of the tilemap
+    tilemap.load("./assets/tilemaps/jungle.map", "tilemap-image", MAP_NUM_COLS, MAP_NUM_ROWS, TILE_SIZE, TILE_SCALE);
 
     // Create an entity
-    Entity tank = registry->CreateEntity();
+    Entity tank = world.CreateEntity();
     tank.AddComponent<TransformComponent>(glm::vec2(10.0, 30.0), glm::vec2(2.0, 2.0), 0.0);
     tank.AddComponent<RigidBodyComponent>(glm::vec2(40.0, 0.0));
     tank.AddComponent<SpriteComponent>("tank-image", 32, 32);
+    tank.AddComponent<MinimapBlipComponent>(SDL_Color{ 255, 60, 60, 255 });
 
-    Entity truck = registry->CreateEntity();
+    Entity truck = world.CreateEntity();
     truck.AddComponent<TransformComponent>(glm::vec2(50.0, 100.0), glm::vec2(2.0, 2.0), 0.0);
     truck.AddComponent<RigidBodyComponent>(glm::vec2(0.0, 50.0));
     truck.AddComponent<SpriteComponent>("truck-image", 32, 32);
+    truck.AddComponent<MinimapBlipComponent>(SDL_Color{ 255, 60, 60, 255 });
+
+    // A tank drifting across the screen and one driven with WASD, both wrapping around the screen edges
+    Entity drifter = world.CreateEntity();
+    drifter.AddComponent<TransformComponent>(glm::vec2(10.0, 20.0), glm::vec2(1.0, 1.0), 0.0);
+    drifter.AddComponent<RigidBodyComponent>(glm::vec2(200.0, 200.0));
+    drifter.AddComponent<SpriteComponent>("tank-tiger-image", 32, 32);
+    drifter.AddComponent<WrapAroundComponent>();
+    drifter.AddComponent<MinimapBlipComponent>(SDL_Color{ 255, 60, 60, 255 });
+
+    Entity player = world.CreateEntity();
+    player.AddComponent<TransformComponent>(glm::vec2(100.0, 20.0), glm::vec2(1.0, 1.0), 0.0);
+    player.AddComponent<RigidBodyComponent>();
+    player.AddComponent<SpriteComponent>("tank-tiger-image", 32, 32, 0, 0, 1);
+    player.AddComponent<KeyboardControlledComponent>(200.0f);
+    player.AddComponent<WrapAroundComponent>();
+    player.AddComponent<CameraFollowComponent>();
+    player.AddComponent<VisionComponent>(5);
+    player.AddComponent<MinimapBlipComponent>(SDL_Color{ 60, 255, 60, 255 });
+
+    Entity chopper = world.CreateEntity();
+    chopper.AddComponent<TransformComponent>(glm::vec2(200.0, 150.0), glm::vec2(1.0, 1.0), 0.0);
+    chopper.AddComponent<RigidBodyComponent>(glm::vec2(60.0, 0.0));
+    chopper.AddComponent<SpriteComponent>("chopper-image", 32, 32, 0, 0, 2);
+    chopper.AddComponent<AnimationComponent>(&chopper_clip);
+    chopper.AddComponent<WrapAroundComponent>();
+    chopper.AddComponent<VisionComponent>(3);
+    chopper.AddComponent<MinimapBlipComponent>(SDL_Color{ 60, 255, 60, 255 });
 }
 
-void Game::setup() {
-    move_sound = Mix_LoadWAV("./assets/sounds/helicopter.wav");
-    if (!move_sound) {
-        std::cerr << "Mix_LoadWAV failed: " << Mix_GetError() << '\n';
-        return;
-    }
 
-    back_music = Mix_LoadMUS("./assets/sounds/music.wav");
-    if (!back_music) 
+void Game::PreloadLevel(int level)
+{
+    if (next_world.valid()) 
     {
-        std::cerr << "Mix_LoadMUS failed: " << Mix_GetError() << '\n';
+        Logger::War("A level is already being preloaded");
         return;
     }
 
-    font = TTF_OpenFont("./assets/fonts/arial.ttf", 18);
-    if (!font) 
+    // Textures belong to the renderer, so they are uploaded by the render thread and not the worker
+    LoadLevelAssets(level);
+
+    // The entities and the tiles are built into a staging world on a worker thread
+    next_level = level;
+    next_tilemap = std::make_unique<Tilemap>();
+    Tilemap* staging_tilemap = next_tilemap.get();
+    next_world = std::async(std::launch::async, [level, staging_tilemap]() {
+        auto world = std::make_unique<Registry>();
+        BuildLevel(*world, *staging_tilemap, level);
+        return world;
+    });
+}
+
+
+void Game::SwitchToPreloadedLevel()
+{
+    // Not started, or still being built: keep running the current level
+    if (!next_world.valid() || next_world.wait_for(std::chrono::seconds(0)) != std::future_status::ready) 
     {
-        std::cerr << "TTF_OpenFont failed: " << TTF_GetError() << '\n';
         return;
     }
 
-    Mix_PlayMusic(back_music, -1);
-    Mix_VolumeMusic(1);
-    Mix_Volume(-1, 0);
+    // Systems and groups stay, only the entities of the active world are replaced
+    std::unique_ptr<Registry> staging_world = next_world.get();
+    registry->Clear();
+    registry->Merge(*staging_world);
+
+    // The chunk textures of the new tilemap are created here, they are baked on the next render.
+    // The old ones are destroyed after the frame that may still draw them has been presented.
+    // Nothing of the new level has been seen yet
+    fog.resize(MAP_NUM_COLS, MAP_NUM_ROWS, static_cast<float>(TILE_SIZE * TILE_SCALE));
+    render_thread.invoke([this](SDL_Renderer* renderer) {
+        tilemap->destroy();
+        next_tilemap->create_chunks(renderer, camera.w, camera.h);
+        fog.create_texture(renderer);
+        minimap.create_texture(renderer, *next_tilemap, MINIMAP_SIZE);
+    });
+    tilemap = std::move(next_tilemap);
+    mapWidth = tilemap->get_width();
+    mapHeight = tilemap->get_height();
+    current_level = next_level;
+
+    Logger::Log("Switched to level " + std::to_string(current_level));
+}
+
+void Game::setup() {
+    // Missing sounds only mute the game
+    if (audio_enabled) {
+        move_sound = Mix_LoadWAV("./assets/sounds/helicopter.wav");
+        if (!move_sound) {
+            Logger::War("Mix_LoadWAV failed: " + std::string(Mix_GetError()));
+        }
+
+        back_music = Mix_LoadMUS("./assets/sounds/music.wav");
+        if (!back_music) {
+            Logger::War("Mix_LoadMUS failed: " + std::string(Mix_GetError()));
+        }
+    }
+
+    // HUD text is drawn from the glyph atlas of this font
+    render_thread.invoke([this](SDL_Renderer* renderer) {
+        assetStore->add_font(renderer, "arial-font", "./assets/fonts/arial.ttf", 18);
+    });
+    hud_font = assetStore->get_font_atlas("arial-font");
+    if (!hud_font) {
+        Logger::War("The HUD font failed to load, the FPS text is not drawn");
+    }
+
+    if (back_music) {
+        Mix_PlayMusic(back_music, -1);
+        Mix_VolumeMusic(1);
+        Mix_Volume(-1, 0);
+    }
+
+    eventBus->SubscribeToEvent<KeyPressedEvent, &Game::on_key_pressed>(this);
+
+    // The software renderer scales and rotates every pixel of every copy, it draws
+    // the transformed sprites from pre-scaled copies instead
+    bool software_renderer = false;
+    render_thread.invoke([&](SDL_Renderer* renderer) {
+        SDL_RendererInfo info;
+        software_renderer = SDL_GetRendererInfo(renderer, &info) == 0 && (info.flags & SDL_RENDERER_SOFTWARE);
+    });
+    assetStore->set_scaled_cache(software_renderer && !naive_render);
 
     LoadLevel(1);
 
     key_state = SDL_GetKeyboardState(NULL);
     prev_ticks = SDL_GetTicks64();
+    prev_counter = SDL_GetPerformanceCounter();
 }
 
 
 void Game::update() {
-    curr_ticks = SDL_GetTicks64();
-    // If we are too fast, waste some time until we reach the MILLISECS_PER_FRAME
-    int time_wait = MILLISECS_PER_FRAME - (SDL_GetTicks64() - mills_prev_frame);
-    if (time_wait > 0 && time_wait <= MILLISECS_PER_FRAME) {
-        SDL_Delay(time_wait);
+    double frame_seconds = 0.0;
+    if (headless) {
+        // Virtual clock: every frame is exactly one simulation step and runs as fast as it can,
+        // so two runs of the same number of frames simulate and draw the same thing
+        frame_seconds = fixed_dt;
+        fps = static_cast<int>(1.0 / fixed_dt + 0.5);
+    }
+    else {
+        curr_ticks = SDL_GetTicks64();
+        // If we are too fast, waste some time until we reach the MILLISECS_PER_FRAME
+        int time_wait = MILLISECS_PER_FRAME - (SDL_GetTicks64() - mills_prev_frame);
+        if (time_wait > 0 && time_wait <= MILLISECS_PER_FRAME) {
+            SDL_Delay(time_wait);
+        }
+
+        // Calculate FPS
+        frame_time = SDL_GetTicks64() - prev_ticks;
+        if (frame_time >= 1000) {
+            fps = frames;
+            frames = 0;
+            prev_ticks = SDL_GetTicks64();
+        }
+        frames++;
+        /*printf("fps: %d", fps);*/
+        // The difference in ticks since the last frame, in milliseconds
+        dt = SDL_GetTicks64() - mills_prev_frame;
+        
+        // Store the "previous" frame time
+        mills_prev_frame = SDL_GetTicks64();
+
+        // Measure the real frame time with the high resolution counter, in seconds
+        const Uint64 counter = SDL_GetPerformanceCounter();
+        frame_seconds = static_cast<double>(counter - prev_counter) / SDL_GetPerformanceFrequency();
+        prev_counter = counter;
     }
 
-    // Calculate FPS
-    frame_time = SDL_GetTicks64() - prev_ticks;
-    if (frame_time >= 1000) {
-        fps = frames;
-        frames = 0;
-        prev_ticks = SDL_GetTicks64();
+    // Never try to catch up more than MAX_FRAME_SECONDS, otherwise a slow frame asks for more
+    // simulation steps, which makes the next frame even slower (spiral of death)
+    if (frame_seconds > MAX_FRAME_SECONDS) {
+        frame_seconds = MAX_FRAME_SECONDS;
     }
-    frames++;
-    /*printf("fps: %d", fps);*/
-    // The difference in ticks since the last frame, converted to seconds
-    dt = SDL_GetTicks64() - mills_prev_frame;
-    
-    // Store the "previous" frame time
-    mills_prev_frame = SDL_GetTicks64();
+    accumulator += frame_seconds;
+
+    // Swap in the next level as soon as its world has been built in the background
+    SwitchToPreloadedLevel();
 
     // Update the registry to process the entities that are waiting to be created/deleted
     registry->update();
 
-    // Invoke all the systems that need to update 
-    registry->GetSystem<MovementSystem>().update(dt / 1000);
+    // Invoke all the systems that need to update, in steps of exactly fixed_dt seconds
+    while (accumulator >= fixed_dt) {
+        Uint64 counter = SDL_GetPerformanceCounter();
+        registry->GetSystem<KeyboardControlSystem>().update(key_state);
+        counter = perf_overlay.add_system_time("KeyboardControl", counter);
+        registry->GetSystem<MovementSystem>().update(*registry, fixed_dt);
+        counter = perf_overlay.add_system_time("Movement", counter);
+        registry->GetSystem<WrapAroundSystem>().update(mapWidth, mapHeight);
+        counter = perf_overlay.add_system_time("WrapAround", counter);
+        registry->GetSystem<VisionSystem>().update(fog);
+        counter = perf_overlay.add_system_time("Vision", counter);
+        // Sprites that were off screen in the last frame keep their current frame
+        registry->GetSystem<AnimationSystem>().update(*registry, fixed_dt, registry->GetSystem<RenderSystem>().get_frame_stamp());
+        counter = perf_overlay.add_system_time("Animation", counter);
+        explosions.update(static_cast<float>(fixed_dt));
+        perf_overlay.add_system_time("Particles", counter);
+        accumulator -= fixed_dt;
+    }
+
+    // How far we are between the last two simulation steps, used by the render to interpolate
+    alpha = accumulator / fixed_dt;
 }
 
 
-void Game::process_input() {
+void Game::set_simulation_rate(int hz) {
+    if (hz <= 0) {
+        Logger::Err("Invalid simulation rate " + std::to_string(hz));
+        return;
+    }
+    fixed_dt = 1.0 / hz;
+}
 
-    while (SDL_PollEvent(&sdl_event)) {
-        // ImGui SDL input
-        //ImGui_ImplSDL2_ProcessEvent(&sdl_event);
-        //ImGuiIO& io = ImGui::GetIO();
-        //int mouseX, mouseY;
 
-        //const int buttons = SDL_GetMouseState(&mouseX, &mouseY);
-        //io.MousePos = ImVec2(mouseX, mouseY);
-        //io.MouseDown[0] = buttons & SDL_BUTTON(SDL_BUTTON_LEFT);
-        //io.MouseDown[1] = buttons & SDL_BUTTON(SDL_BUTTON_RIGHT);
+void Game::process_input() {
 
+    while (SDL_PollEvent(&sdl_event)) {
         // Handle SDL core events (close window, key pressed, etc.)
         if (sdl_event.type == SDL_QUIT) {
             quit = true;
         }
         if (sdl_event.type == SDL_KEYDOWN) {
-            if (sdl_event.key.keysym.sym == SDLK_ESCAPE) {
-                quit = true;
-            }
+            eventBus->QueueEvent<KeyPressedEvent>(sdl_event.key.keysym.sym);
         }
     }
-    if (key_state[SDL_SCANCODE_W]) {
-        p1.y -= dt / 5;
+
+    // Deliver the events queued during this frame's input phase
+    eventBus->DispatchQueuedEvents();
+}                
+
+
+void Game::on_key_pressed(KeyPressedEvent& event) {
+    if (event.symbol == SDLK_ESCAPE) {
+        quit = true;
     }
-    if (key_state[SDL_SCANCODE_S]) {
-        p1.y += dt / 5;
+    if (event.symbol == SDLK_n) {
+        PreloadLevel(current_level + 1);
     }
-    if (key_state[SDL_SCANCODE_A]) {
-        p1.x -= dt / 5;
+    if (event.symbol == SDLK_F1) {
+        perf_overlay.toggle();
     }
-    if (key_state[SDL_SCANCODE_D]) {
-        p1.x += dt / 5;
+    if (event.symbol == SDLK_F2) {
+        debug_draw.toggle();
     }
-}                
+    if (event.symbol == SDLK_SPACE) {
+        for (auto entity : registry->GetSystem<KeyboardControlSystem>().GetSystemEntities()) {
+            const auto& transform = entity.GetComponent<TransformComponent>();
+            explosions.emit(5000, transform.pos.x + 16.0f, transform.pos.y + 16.0f);
+        }
+    }
+}
 
 
 void Game::render() {
-        SDL_SetRenderDrawColor(renderer, 21, 21, 21, 255);
-        SDL_RenderClear(renderer);
-
-        registry->GetSystem<RenderSystem>().update(renderer, assetStore);
-        
-        // Draw FPS text
-        SDL_Color textColor = { 0, 255, 0, 255 };
-        std::string fpsText = "FPS: " + std::to_string(fps);
-        SDL_Surface* textSurface = TTF_RenderText_Solid(font, fpsText.c_str(), textColor);
-        SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-        SDL_Rect textRect = { 10, 10, textSurface->w, textSurface->h };
-
-        SDL_RenderCopy(renderer, textTexture, NULL, &textRect);
-        SDL_DestroyTexture(textTexture);
-        SDL_FreeSurface(textSurface);
-
-        // Draw a PNG texture
-        SDL_Surface* surface = IMG_Load("./assets/images/tank-tiger-right.png");
-        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-        SDL_Texture* texture1 = SDL_CreateTextureFromSurface(renderer, surface);
-        
-        p.x += dt / 5;
-        p.y += dt / 5;
-
-        if (p.x > windowWidth) {
-            p.x = 0;
+        // Nothing may be loaded from disk or uploaded to the GPU from here on
+        assetStore->begin_render_phase();
+
+        // The frame is recorded here and drawn by the render thread while the next one is simulated
+        RenderCommandList& commands = render_thread.get_commands();
+        Uint64 counter = SDL_GetPerformanceCounter();
+        registry->GetSystem<CameraMovementSystem>().update(camera, alpha, mapWidth, mapHeight);
+        counter = perf_overlay.add_system_time("CameraMovement", counter);
+        parallax.bake(commands, *assetStore);
+        if (backbuffer) {
+            RenderDirtyRegions(commands);
         }
-        if (p.y > windowHeight) {
-            p.y = 0;
+        else {
+            commands.clear({ 21, 21, 21, 255 });
+            if (naive_render) {
+                tilemap->render_tiles(commands, *assetStore, camera);
+            }
+            else {
+                tilemap->render(commands, *assetStore, camera);
+            }
+            registry->GetSystem<RenderSystem>().update(commands, assetStore, camera, alpha);
         }
-        if (p1.x > windowWidth) {
-            p1.x = 0;
+        counter = perf_overlay.add_system_time("Render", counter);
+
+        // The fog, particles and debug shapes are drawn over the world and not kept
+        fog.render(commands, camera);
+        explosions.render(commands, camera);
+        if (debug_draw.is_enabled()) {
+            registry->GetSystem<RenderSystem>().draw_debug(debug_draw, camera);
+            debug_draw.flush(commands, camera);
+        }
+
+        // The HUD panel is only drawn again when the FPS value changes, the other frames copy it.
+        // The minimap bakes its tiles into its own texture, it is drawn after the panel.
+        if (fps != fps_text_value) {
+            fps_text_value = fps;
+            std::snprintf(fps_text, sizeof(fps_text), "FPS: %d", fps);
+            hud_panel.invalidate();
         }
-        if (p1.x < 0) {
-            p1.x = windowWidth;
+        if (hud_panel.begin(commands)) {
+            const SDL_Rect panel = hud_panel.get_area();
+            commands.fill(panel, { 0, 0, 0, 140 });
+            if (hud_font) {
+                hud_font->draw(commands, fps_text, panel.x + 6.0f, panel.y + 6.0f, { 0, 255, 0, 255 });
+            }
         }
-        if (p1.y > windowHeight) {
-            p1.y = 0;
+        hud_panel.end(commands);
+        counter = SDL_GetPerformanceCounter();
+        registry->GetSystem<MinimapSystem>().update(minimap);
+        minimap.render(commands, *assetStore, *tilemap, camera, static_cast<double>(dt) / 1000.0);
+        perf_overlay.add_system_time("Minimap", counter);
+
+        // Numbers of the last frame presented, the overlay itself isn't counted
+        PerfStats stats;
+        stats.draw_calls = render_thread.get_draw_calls();
+        stats.texture_switches = render_thread.get_texture_switches();
+        stats.sprites_drawn = registry->GetSystem<RenderSystem>().get_drawn();
+        stats.sprites_total = static_cast<int>(registry->GetSystem<RenderSystem>().GetSystemEntities().size());
+        stats.particles = explosions.get_count();
+        perf_overlay.render(commands, stats, static_cast<double>(dt) / 1000.0);
+
+        render_thread.submit();
+
+        // Wait for the frame to be presented, then read it back
+        if (frame_capture.wants(frame_count)) {
+            render_thread.invoke([this](SDL_Renderer* renderer) {
+                frame_capture.capture(renderer, frame_count, render_thread.get_frame_ms());
+            });
         }
-        if (p1.y < 0) {
-            p1.y = windowHeight;
+
+        assetStore->end_render_phase();
+
+        // Copies requested by this frame are drawn from the next one
+        if (assetStore->has_requested_variants()) {
+            render_thread.invoke([this](SDL_Renderer* renderer) {
+                assetStore->build_scaled_variants(renderer);
+            });
         }
- 
-        SDL_Rect dstRect = {
-            static_cast<int>(p.x),
-            static_cast<int>(p.y),
-            32, 32 };
-
-        SDL_Rect dstRect1 = {
-        static_cast<int>(p1.x),
-        static_cast<int>(p1.y),
-        32, 32 };
-
-        SDL_RenderCopy(renderer, texture, NULL, &dstRect);
-        SDL_RenderCopy(renderer, texture1, NULL, &dstRect1);
-        SDL_DestroyTexture(texture);
-        SDL_DestroyTexture(texture1);
-        SDL_FreeSurface(surface);
-
-        SDL_RenderPresent(renderer);
+}
+
+
+void Game::RenderDirtyRegions(RenderCommandList& commands) {
+    // Scrolling moves everything on screen
+    const bool scrolled = !backbuffer_valid || camera.x != backbuffer_camera.x || camera.y != backbuffer_camera.y;
+    backbuffer_valid = true;
+    backbuffer_camera = camera;
+    DrawDirtyRegions(commands, registry->GetSystem<RenderSystem>(), assetStore, tilemap.get(), backbuffer, camera, alpha, scrolled, 
+        dirty_regions, baked_rects);
+}
+
+
+void Game::DrawDirtyRegions(RenderCommandList& commands, RenderSystem& render_system, std::unique_ptr<AssetStore>& asset_store, 
+    Tilemap* tilemap, SDL_Texture* backbuffer, const SDL_Rect& camera, double alpha, bool redraw_all, 
+    DirtyRegions& dirty_regions, std::vector<SDL_Rect>& baked_rects) {
+    // Chunks baked this frame changed under the sprites
+    baked_rects.clear();
+    if (tilemap) {
+        tilemap->bake_visible(commands, *asset_store, camera, &baked_rects);
+    }
+
+    dirty_regions.clear();
+    render_system.collect_dirty(camera, alpha, dirty_regions);
+    for (const auto& rect : baked_rects) {
+        dirty_regions.add(rect);
+    }
+    if (redraw_all) {
+        dirty_regions.invalidate();
+    }
+    dirty_regions.finish(camera);
+
+    // Each area is drawn again from the bottom, only the pixels inside of it are touched
+    commands.set_target(backbuffer);
+    for (const auto& area : dirty_regions.get_rects()) {
+        const SDL_Rect screen_rect = { area.x - camera.x, area.y - camera.y, area.w, area.h };
+        commands.set_clip(screen_rect);
+        commands.fill(screen_rect, { 21, 21, 21, 255 });
+        if (tilemap) {
+            tilemap->draw(commands, camera, area);
+        }
+        render_system.draw_area(commands, asset_store, camera, area, alpha);
+    }
+    commands.reset_clip();
+    commands.set_target(nullptr);
+    commands.copy(backbuffer, { 0, 0, camera.w, camera.h });
 }
 
 
 void Game::run() {
     setup();
+    const Uint64 start_counter = SDL_GetPerformanceCounter();
+    Uint64 frame_counter = start_counter;
     while (!quit) {
         update();
         process_input();
         render();
+
+        const Uint64 counter = SDL_GetPerformanceCounter();
+        perf_overlay.end_frame(static_cast<double>(counter - frame_counter) * 1000.0 / SDL_GetPerformanceFrequency(), render_thread.get_frame_ms());
+        frame_counter = counter;
+
+        frame_count++;
+        if (max_frames > 0 && frame_count >= max_frames) {
+            quit = true;
+        }
     }
+
+    const double seconds = static_cast<double>(SDL_GetPerformanceCounter() - start_counter) / SDL_GetPerformanceFrequency();
+    Logger::Log("Ran " + std::to_string(frame_count) + " frames in " + std::to_string(seconds * 1000.0) + " ms, " + 
+        std::to_string(frame_count > 0 ? seconds * 1000.0 / frame_count : 0.0) + " ms per frame");
 }
 
 
 void Game::destroy() {
-    //ImGuiSDL::Deinitialize();
-    //ImGui::DestroyContext();
-    Mix_FreeChunk(move_sound);
-    Mix_FreeMusic(back_music);
-    Mix_CloseAudio();
+    // Textures and fonts have to go before their renderer and SDL_ttf, the renderer
+    // is destroyed when the render thread stops
+    render_thread.invoke([this](SDL_Renderer*) {
+        if (tilemap) {
+            tilemap->destroy();
+        }
+        fog.destroy();
+        minimap.destroy();
+        parallax.destroy();
+        SDL_DestroyTexture(backbuffer);
+        backbuffer = nullptr;
+        perf_overlay.destroy_font_texture();
+        hud_panel.destroy();
+        assetStore->clear_assets();
+    });
+    render_thread.stop();
+    perf_overlay.shutdown();
+    SDL_FreeSurface(headless_surface);
+    if (audio_enabled) {
+        Mix_FreeChunk(move_sound);
+        Mix_FreeMusic(back_music);
+        Mix_CloseAudio();
+    }
     Mix_Quit();
-    TTF_CloseFont(font);
     TTF_Quit();
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
+    if (window) {
+        SDL_DestroyWindow(window);
+    }
     SDL_Quit();
 }
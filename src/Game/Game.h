@@ -3,6 +3,20 @@
 
 #include "../ECS/ECS.h"
 #include "../AssetStore/AssetStore.h"
+#include "../EventBus/EventBus.h"
+#include "../Events/KeyPressedEvent.h"
+#include "../Renderer/RenderThread.h"
+#include "../Renderer/FrameCapture.h"
+#include "../Renderer/FontAtlas.h"
+#include "../Renderer/DebugDraw.h"
+#include "../Renderer/DirtyRegions.h"
+#include "../Renderer/PerfOverlay.h"
+#include "../Renderer/CachedPanel.h"
+#include "../Tilemap/FogOfWar.h"
+#include "../Tilemap/Minimap.h"
+#include "../Tilemap/Parallax.h"
+#include "../Tilemap/Tilemap.h"
+#include "../Particles/ParticleEmitter.h"
 
 #define SDL_MAIN_HANDLED
 #include <SDL2/SDL.h>
@@ -10,10 +24,22 @@
 #include <SDL2/SDL_mixer.h>
 #include <SDL2/SDL_ttf.h>
 #include <glm/glm.hpp>
+#include <future>
+
+class RenderSystem;
 
 const int FPS = 60;
 const int MILLISECS_PER_FRAME = 1000 / FPS;
 
+// Default rate of the fixed step simulation, independent from the render rate
+const int SIMULATION_HZ = 60;
+// Longest frame time the simulation tries to catch up with
+const double MAX_FRAME_SECONDS = 0.25;
+
+// Size of the offscreen surface rendered into without a window
+const int HEADLESS_WIDTH = 1280;
+const int HEADLESS_HEIGHT = 720;
+
 class Game 
 {
 private:
@@ -24,38 +50,105 @@ private:
 	int fps{};
 
 	SDL_Window* window{};
-	SDL_Renderer* renderer{};
-	TTF_Font* font{};
+	// Without a window the software renderer draws into this surface
+	SDL_Surface* headless_surface{};
+	bool headless{};
+	bool audio_enabled{};
+	// Frames to run before quitting, 0 runs until the window is closed
+	int max_frames{};
+	int frame_count{};
+	// Frames read back for render regression checks, and the unoptimized path they are checked against
+	FrameCapture frame_capture{};
+	bool naive_render{};
+	// Dirty rectangle mode: the world is kept in the backbuffer and only the areas that changed are drawn again
+	bool dirty_render{};
+	SDL_Texture* backbuffer{};
+	bool backbuffer_valid{};
+	SDL_Rect backbuffer_camera{};
+	DirtyRegions dirty_regions{};
+	std::vector<SDL_Rect> baked_rects{};
+	// HUD panel with the FPS text, only drawn again when the text changes
+	CachedPanel hud_panel{};
+	// Render statistics and system timings, toggled with F1
+	PerfOverlay perf_overlay{};
+	// Sprite bounds, grid cells and velocities, toggled with F2 in builds with DEBUG_DRAW
+	DebugDraw debug_draw{};
+	// Owns the renderer, everything that needs it goes through the render thread
+	RenderThread render_thread{};
+	const FontAtlas* hud_font{};
+	char fps_text[32]{};
+	int fps_text_value{ -1 };
 	const Uint8* key_state{};
 	Mix_Chunk* move_sound{};
 	Mix_Music* back_music{};
 	SDL_Event sdl_event{};
-	//SDL_Rect camera{};
+	SDL_Rect camera{};
 	Uint32 prev_ticks{};
 	Uint32 curr_ticks{};
 	Uint32 frame_time{};
-	glm::vec2 p{};
-	glm::vec2 p1{};
+	Uint64 prev_counter{};
+	double fixed_dt{ 1.0 / SIMULATION_HZ };
+	double accumulator{};
+	double alpha{};
 
 	std::unique_ptr<Registry> registry{};
 	std::unique_ptr<AssetStore> assetStore{};
+	std::unique_ptr<EventBus> eventBus{};
+	std::unique_ptr<Tilemap> tilemap{};
+	// Tiles seen by the units with a VisionComponent, drawn over the world
+	FogOfWar fog{};
+	// Level overview with the unit blips, in the top right corner
+	Minimap minimap{};
+	// Tree tops scrolling faster than the ground, between the ground units and the chopper
+	Parallax parallax{};
+	// Explosions spawned with space at the player's position
+	ParticleEmitter explosions{ 200000 };
+
+	// Level being built on a worker thread while the current one keeps running
+	int current_level{};
+	int next_level{};
+	// Declared first so a pending build finishes before its tilemap is freed
+	std::unique_ptr<Tilemap> next_tilemap{};
+	std::future<std::unique_ptr<Registry>> next_world{};
+
+	void LoadLevelAssets(int level);
+	void SwitchToPreloadedLevel();
+	void RenderDirtyRegions(RenderCommandList& commands);
+	void on_key_pressed(KeyPressedEvent& event);
 
 public:
 	Game();
 	~Game();
+	// Call before initialize(): no window, no audio, a software renderer and a fixed virtual clock
+	void set_headless(bool headless);
+	void set_max_frames(int frames);
+	// No chunks, culling, radix sort or batching: the reference the optimized render is compared to
+	void set_naive_render(bool naive);
+	// Call before initialize(): redraw only what moved since the last frame, ignored with the naive render
+	void set_dirty_render(bool dirty);
+	FrameCapture& get_frame_capture() { return frame_capture; }
+	void set_perf_overlay(bool visible) { perf_overlay.set_visible(visible); }
 	void initialize();
 	void run();
 	void LoadLevel(int level);
+	void PreloadLevel(int level);
+	static void BuildLevel(Registry& world, Tilemap& tilemap, int level);
+	// Records a frame of the dirty rectangle mode into backbuffer, then copies it on the screen: the chunks baked and
+	// the sprites moved since the last frame are drawn again, or the whole view with redraw_all. tilemap can be nullptr.
+	static void DrawDirtyRegions(RenderCommandList& commands, RenderSystem& render_system, std::unique_ptr<AssetStore>& asset_store, 
+		Tilemap* tilemap, SDL_Texture* backbuffer, const SDL_Rect& camera, double alpha, bool redraw_all, 
+		DirtyRegions& dirty_regions, std::vector<SDL_Rect>& baked_rects);
 	void setup();
 	void process_input();
 	void update();
+	void set_simulation_rate(int hz);
 	void render();
 	void destroy();
 
 	static int windowWidth;
 	static int windowHeight;
-	//static int mapWidth;
-	//static int mapHeight;
+	static int mapWidth;
+	static int mapHeight;
 };
 
 #endif
@@ -6,8 +6,13 @@
 #include <chrono>
 #include <ctime>
 #include <stdio.h>
+#include <mutex>
 
 std::vector<Log_entry> Logger::messages; // Anything declared static in the .h has to be defined in the .cpp
+Log_type Logger::level = LOG_INFO;
+
+// Worlds can be built on background threads, so the shared message list is guarded
+static std::mutex log_mutex;
 
 std::string Current_date_time_to_string() {
     std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
@@ -17,6 +22,10 @@ std::string Current_date_time_to_string() {
 }
 
 void Logger::Log(const std::string& message) {
+    if (level > LOG_INFO) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(log_mutex);
     Log_entry log_entry;
     log_entry.type = LOG_INFO;
     log_entry.message = "LOG: [" + Current_date_time_to_string() + "]: " + message;
@@ -25,14 +34,19 @@ void Logger::Log(const std::string& message) {
 }
 
 void Logger::War(const std::string& message) {
+    if (level > LOG_WARNING) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(log_mutex);
     Log_entry log_entry;
-    log_entry.type = LOG_INFO;
+    log_entry.type = LOG_WARNING;
     log_entry.message = "WAR: [" + Current_date_time_to_string() + "]: " + message;
     std::cout << "\x1B[33m" << log_entry.message << "\033[0m" << std::endl;
     messages.push_back(log_entry);
 }
 
 void Logger::Err(const std::string& message) {
+    std::lock_guard<std::mutex> lock(log_mutex);
     Log_entry log_entry;
     log_entry.type = LOG_ERROR;
     log_entry.message = "ERR: [" + Current_date_time_to_string() + "]: " + message;
@@ -18,6 +18,7 @@ struct Log_entry {
 class Logger {
     public:
         static std::vector<Log_entry> messages; // One vector for the entire class
+        static Log_type level; // Messages of a lower type are dropped (e.g. LOG_ERROR for benchmarks)
         // static so that it is not necessary to create instances of this class
         static void Log(const std::string& message); // static methods
         static void War(const std::string& message);
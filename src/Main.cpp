@@ -1,7 +1,9 @@
 #include "./Game/Game.h"
 
 #include <sol/sol.hpp>
+#include <cstdlib>
 #include <iostream>
+#include <string>
 
 
 int nativeCppCubeFunction(int n) {
@@ -39,12 +41,60 @@ void test_lua() {
 int main(int argc, char* argv[]) {
     Game game;
 
+    // --headless renders offscreen without audio, --frames N quits after N frames,
+    // --sim-hz N changes the rate of the fixed step simulation.
+    // Render regression: --capture 0,60,120 writes these frames to --capture-dir (./captures),
+    // as PNG or with --capture-raw as RGBA, and compares them with the ones in --golden-dir,
+    // allowing --tolerance per channel. --naive-render draws without the render optimizations.
+    // --dirty-rects only redraws the parts of the screen that changed.
+    // --perf-overlay starts with the statistics overlay shown, F1 toggles it.
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--headless") {
+            game.set_headless(true);
+        }
+        else if (arg == "--frames" && i + 1 < argc) {
+            game.set_max_frames(std::atoi(argv[++i]));
+        }
+        else if (arg == "--sim-hz" && i + 1 < argc) {
+            game.set_simulation_rate(std::atoi(argv[++i]));
+        }
+        else if (arg == "--capture" && i + 1 < argc) {
+            game.get_frame_capture().set_frames(argv[++i]);
+        }
+        else if (arg == "--capture-dir" && i + 1 < argc) {
+            game.get_frame_capture().set_output_dir(argv[++i]);
+        }
+        else if (arg == "--golden-dir" && i + 1 < argc) {
+            game.get_frame_capture().set_golden_dir(argv[++i]);
+        }
+        else if (arg == "--tolerance" && i + 1 < argc) {
+            game.get_frame_capture().set_tolerance(std::atoi(argv[++i]));
+        }
+        else if (arg == "--capture-raw") {
+            game.get_frame_capture().set_raw(true);
+        }
+        else if (arg == "--naive-render") {
+            game.set_naive_render(true);
+        }
+        else if (arg == "--dirty-rects") {
+            game.set_dirty_render(true);
+        }
+        else if (arg == "--perf-overlay") {
+            game.set_perf_overlay(true);
+        }
+        else {
+            std::cerr << "Unknown argument " << arg << '\n';
+        }
+    }
+
     game.initialize();
     game.run();
     game.destroy();
     test_lua();
     
-    return 0;
+    // Frames that didn't match their golden image fail the run
+    return game.get_frame_capture().get_failures() > 0 ? 1 : 0;
 }
 
 //#define SDL_MAIN_HANDLED
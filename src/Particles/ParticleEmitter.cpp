@@ -0,0 +1,223 @@
+#include "ParticleEmitter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PARTICLES_SSE
+#endif
+
+ParticleEmitter::ParticleEmitter(int capacity, uint32_t seed) : 
+	capacity{ std::max(capacity, 0) }, 
+	rng_state{ seed ? seed : 1 }
+{
+	// The padding lanes are integrated with the rest and ignored
+	const size_t padded = (static_cast<size_t>(this->capacity) + 3) & ~static_cast<size_t>(3);
+	pos_x.resize(padded);
+	pos_y.resize(padded);
+	vel_x.resize(padded);
+	vel_y.resize(padded);
+	life.resize(padded);
+	inv_lifetime.resize(padded);
+	colors.resize(padded);
+}
+
+float ParticleEmitter::random(float min, float max) 
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return min + (max - min) * static_cast<float>(rng_state >> 8) * (1.0f / 16777216.0f);
+}
+
+void ParticleEmitter::kill(int idx) 
+{
+	// Swap with the last live particle, the order of the particles doesn't matter
+	count--;
+	pos_x[idx] = pos_x[count];
+	pos_y[idx] = pos_y[count];
+	vel_x[idx] = vel_x[count];
+	vel_y[idx] = vel_y[count];
+	life[idx] = life[count];
+	inv_lifetime[idx] = inv_lifetime[count];
+	colors[idx] = colors[count];
+}
+
+int ParticleEmitter::emit(int num_particles, float x, float y) 
+{
+	const int spawned = std::max(0, std::min(num_particles, capacity - count));
+	const float degrees_to_radians = 3.14159265f / 180.0f;
+	for (int i = 0; i < spawned; i++) 
+	{
+		const float angle = random(min_angle, max_angle) * degrees_to_radians;
+		const float speed = random(min_speed, max_speed);
+		const float lifetime = std::max(random(min_lifetime, max_lifetime), 0.001f);
+		const float mix = random(0.0f, 1.0f);
+
+		pos_x[count] = x;
+		pos_y[count] = y;
+		vel_x[count] = std::cos(angle) * speed;
+		vel_y[count] = std::sin(angle) * speed;
+		life[count] = lifetime;
+		inv_lifetime[count] = 1.0f / lifetime;
+		colors[count] = {
+			static_cast<Uint8>(first_color.r + (second_color.r - first_color.r) * mix),
+			static_cast<Uint8>(first_color.g + (second_color.g - first_color.g) * mix),
+			static_cast<Uint8>(first_color.b + (second_color.b - first_color.b) * mix),
+			static_cast<Uint8>(first_color.a + (second_color.a - first_color.a) * mix)
+		};
+		count++;
+	}
+	return spawned;
+}
+
+void ParticleEmitter::update(float dt) 
+{
+	// Bit i set when particle i of a group of 4 died during this step
+	int any_dead = 0;
+
+#ifdef PARTICLES_SSE
+	const __m128 step = _mm_set1_ps(dt);
+	const __m128 fall = _mm_set1_ps(gravity * dt);
+	const __m128 zero = _mm_setzero_ps();
+	for (int i = 0; i < count; i += 4) 
+	{
+		const __m128 vx = _mm_loadu_ps(&vel_x[i]);
+		const __m128 vy = _mm_add_ps(_mm_loadu_ps(&vel_y[i]), fall);
+		const __m128 left = _mm_sub_ps(_mm_loadu_ps(&life[i]), step);
+		_mm_storeu_ps(&vel_y[i], vy);
+		_mm_storeu_ps(&pos_x[i], _mm_add_ps(_mm_loadu_ps(&pos_x[i]), _mm_mul_ps(vx, step)));
+		_mm_storeu_ps(&pos_y[i], _mm_add_ps(_mm_loadu_ps(&pos_y[i]), _mm_mul_ps(vy, step)));
+		_mm_storeu_ps(&life[i], left);
+
+		// The lanes past the last live particle are ignored
+		int dead = _mm_movemask_ps(_mm_cmple_ps(left, zero));
+		if (count - i < 4) 
+		{
+			dead &= (1 << (count - i)) - 1;
+		}
+		any_dead |= dead;
+	}
+#else
+	for (int i = 0; i < count; i++) 
+	{
+		vel_y[i] += gravity * dt;
+		pos_x[i] += vel_x[i] * dt;
+		pos_y[i] += vel_y[i] * dt;
+		life[i] -= dt;
+		any_dead |= life[i] <= 0.0f;
+	}
+#endif
+
+	if (!any_dead) 
+	{
+		return;
+	}
+
+	// Backwards, so the particle swapped in has already been checked
+	for (int i = count - 1; i >= 0; i--) 
+	{
+		if (life[i] <= 0.0f) 
+		{
+			kill(i);
+		}
+	}
+}
+
+void ParticleEmitter::render(RenderCommandList& commands, const SDL_Rect& camera) const 
+{
+	if (count == 0) 
+	{
+		return;
+	}
+
+	RenderVertices vertices = commands.add_quads(count);
+	float* xy = vertices.xy;
+	SDL_Color* color = vertices.colors;
+
+	// Corners of the quads in screen space, counterclockwise from the top left
+	const float left = -static_cast<float>(camera.x) - size * 0.5f;
+	const float top = -static_cast<float>(camera.y) - size * 0.5f;
+	int i = 0;
+
+#ifdef PARTICLES_SSE
+	const __m128 offset_x = _mm_set1_ps(left);
+	const __m128 offset_y = _mm_set1_ps(top);
+	const __m128 extent = _mm_set1_ps(size);
+	for (; i + 4 <= count; i += 4) 
+	{
+		const __m128 x0 = _mm_add_ps(_mm_loadu_ps(&pos_x[i]), offset_x);
+		const __m128 y0 = _mm_add_ps(_mm_loadu_ps(&pos_y[i]), offset_y);
+		const __m128 x1 = _mm_add_ps(x0, extent);
+		const __m128 y1 = _mm_add_ps(y0, extent);
+
+		// Interleave into x0 y0 x1 y0 x1 y1 x0 y1 for each of the 4 particles
+		const __m128 top_left = _mm_unpacklo_ps(x0, y0);
+		const __m128 top_right = _mm_unpacklo_ps(x1, y0);
+		const __m128 bottom_right = _mm_unpacklo_ps(x1, y1);
+		const __m128 bottom_left = _mm_unpacklo_ps(x0, y1);
+		_mm_storeu_ps(xy + 0, _mm_movelh_ps(top_left, top_right));
+		_mm_storeu_ps(xy + 4, _mm_movelh_ps(bottom_right, bottom_left));
+		_mm_storeu_ps(xy + 8, _mm_movehl_ps(top_right, top_left));
+		_mm_storeu_ps(xy + 12, _mm_movehl_ps(bottom_left, bottom_right));
+
+		const __m128 top_left_hi = _mm_unpackhi_ps(x0, y0);
+		const __m128 top_right_hi = _mm_unpackhi_ps(x1, y0);
+		const __m128 bottom_right_hi = _mm_unpackhi_ps(x1, y1);
+		const __m128 bottom_left_hi = _mm_unpackhi_ps(x0, y1);
+		_mm_storeu_ps(xy + 16, _mm_movelh_ps(top_left_hi, top_right_hi));
+		_mm_storeu_ps(xy + 20, _mm_movelh_ps(bottom_right_hi, bottom_left_hi));
+		_mm_storeu_ps(xy + 24, _mm_movehl_ps(top_right_hi, top_left_hi));
+		_mm_storeu_ps(xy + 28, _mm_movehl_ps(bottom_left_hi, bottom_right_hi));
+		xy += 32;
+	}
+#endif
+
+	for (int j = i; j < count; j++) 
+	{
+		const float x0 = pos_x[j] + left;
+		const float y0 = pos_y[j] + top;
+		const float x1 = x0 + size;
+		const float y1 = y0 + size;
+		xy[0] = x0; xy[1] = y0;
+		xy[2] = x1; xy[3] = y0;
+		xy[4] = x1; xy[5] = y1;
+		xy[6] = x0; xy[7] = y1;
+		xy += 8;
+	}
+
+	// Fade out over the lifetime
+	i = 0;
+
+#ifdef PARTICLES_SSE
+	// The alpha is the top byte of each color, every color is written to the 4 vertices of its quad
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+	for (; i + 4 <= count; i += 4) 
+	{
+		const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&colors[i]));
+		const __m128 fade = _mm_min_ps(_mm_mul_ps(_mm_loadu_ps(&life[i]), _mm_loadu_ps(&inv_lifetime[i])), one);
+		const __m128 alpha = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(packed, 24)), fade);
+		const __m128i faded = _mm_or_si128(_mm_and_si128(packed, rgb_mask), _mm_slli_epi32(_mm_cvttps_epi32(alpha), 24));
+
+		__m128i* out = reinterpret_cast<__m128i*>(color);
+		_mm_storeu_si128(out + 0, _mm_shuffle_epi32(faded, _MM_SHUFFLE(0, 0, 0, 0)));
+		_mm_storeu_si128(out + 1, _mm_shuffle_epi32(faded, _MM_SHUFFLE(1, 1, 1, 1)));
+		_mm_storeu_si128(out + 2, _mm_shuffle_epi32(faded, _MM_SHUFFLE(2, 2, 2, 2)));
+		_mm_storeu_si128(out + 3, _mm_shuffle_epi32(faded, _MM_SHUFFLE(3, 3, 3, 3)));
+		color += 16;
+	}
+#endif
+
+	for (int j = i; j < count; j++) 
+	{
+		SDL_Color faded = colors[j];
+		faded.a = static_cast<Uint8>(faded.a * std::min(life[j] * inv_lifetime[j], 1.0f));
+		color[0] = faded;
+		color[1] = faded;
+		color[2] = faded;
+		color[3] = faded;
+		color += 4;
+	}
+}
@@ -0,0 +1,81 @@
+#ifndef PARTICLEEMITTER_H
+#define PARTICLEEMITTER_H
+
+#include "../Renderer/RenderCommandList.h"
+
+#include <cstdint>
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// ParticleEmitter
+////////////////////////////////////////////////////////////////////////////////
+// Short lived colored squares for explosions, smoke and the like. Particles are
+// not entities: every attribute is a separate array of a fixed capacity, the
+// live particles packed at the front. They are integrated 4 at a time with SSE,
+// a dead particle is replaced by the last live one, and all of them are drawn
+// with a single geometry command. Particles are in world space and fade out
+// over their lifetime.
+////////////////////////////////////////////////////////////////////////////////
+class ParticleEmitter 
+{
+private:
+	int capacity;
+	int count = 0;
+
+	// [Vector index = particle], padded to a multiple of 4 for the SIMD loops
+	std::vector<float> pos_x;
+	std::vector<float> pos_y;
+	std::vector<float> vel_x;
+	std::vector<float> vel_y;
+	// Seconds left, and the inverse of the lifetime the particle started with
+	std::vector<float> life;
+	std::vector<float> inv_lifetime;
+	std::vector<SDL_Color> colors;
+
+	// Ranges the spawned particles are picked from, angles in degrees
+	float min_speed = 20.0f;
+	float max_speed = 120.0f;
+	float min_angle = 0.0f;
+	float max_angle = 360.0f;
+	float min_lifetime = 0.5f;
+	float max_lifetime = 1.5f;
+	SDL_Color first_color = { 255, 220, 80, 255 };
+	SDL_Color second_color = { 200, 40, 0, 255 };
+	float gravity = 0.0f;
+	float size = 2.0f;
+
+	// xorshift, the same seed spawns the same particles
+	uint32_t rng_state;
+
+	float random(float min, float max);
+	void kill(int idx);
+
+public:
+	ParticleEmitter(int capacity, uint32_t seed = 1);
+	~ParticleEmitter() = default;
+
+	void set_speed(float min, float max) { min_speed = min; max_speed = max; }
+	void set_angle(float min, float max) { min_angle = min; max_angle = max; }
+	void set_lifetime(float min, float max) { min_lifetime = min; max_lifetime = max; }
+	// Every particle gets a color between the two
+	void set_colors(SDL_Color first, SDL_Color second) { first_color = first; second_color = second; }
+	// Pixels per second squared, positive goes down
+	void set_gravity(float gravity) { this->gravity = gravity; }
+	void set_size(float size) { this->size = size; }
+
+	// Spawns particles at (x, y), the ones that don't fit are dropped. Returns how many were spawned.
+	int emit(int num_particles, float x, float y);
+	void update(float dt);
+	void clear() { count = 0; }
+
+	// Records the live particles as one geometry command
+	void render(RenderCommandList& commands, const SDL_Rect& camera) const;
+
+	int get_count() const { return count; }
+	int get_capacity() const { return capacity; }
+};
+
+#endif
@@ -0,0 +1,64 @@
+#include "CachedPanel.h"
+#include "../Logger/Logger.h"
+
+#include <string>
+
+void CachedPanel::create_texture(SDL_Renderer* renderer) 
+{
+	destroy();
+	if (rect.w <= 0 || rect.h <= 0) 
+	{
+		return;
+	}
+
+	texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, rect.w, rect.h);
+	if (!texture) 
+	{
+		Logger::Err("Error creating a panel texture: " + std::string(SDL_GetError()));
+		return;
+	}
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+}
+
+void CachedPanel::destroy() 
+{
+	if (texture) 
+	{
+		SDL_DestroyTexture(texture);
+		texture = nullptr;
+	}
+	valid = false;
+}
+
+bool CachedPanel::begin(RenderCommandList& commands) 
+{
+	if (!texture) 
+	{
+		return true;
+	}
+
+	if (valid) 
+	{
+		commands.copy(texture, rect);
+		return false;
+	}
+
+	commands.set_target(texture);
+	commands.clear({ 0, 0, 0, 0 });
+	drawing = true;
+	redraws++;
+	return true;
+}
+
+void CachedPanel::end(RenderCommandList& commands) 
+{
+	if (!drawing) 
+	{
+		return;
+	}
+
+	commands.set_target(nullptr);
+	commands.copy(texture, rect);
+	valid = true;
+	drawing = false;
+}
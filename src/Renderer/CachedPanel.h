@@ -0,0 +1,56 @@
+#ifndef CACHEDPANEL_H
+#define CACHEDPANEL_H
+
+#include "RenderCommandList.h"
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// CachedPanel
+////////////////////////////////////////////////////////////////////////////////
+// A rectangle of the screen, like a HUD panel, kept in a render target of its
+// own size. It is only drawn again after being invalidated, the other frames
+// composite it with a single copy. Only worth it for content that rarely
+// changes and costs more to draw than to copy. What the panel draws must not
+// change the render target itself. When the texture can't be created the
+// panel is drawn straight to the screen every frame.
+// create_texture() and destroy() have to run on the thread that owns the renderer.
+////////////////////////////////////////////////////////////////////////////////
+class CachedPanel 
+{
+private:
+	// Where the panel is on the screen
+	SDL_Rect rect = { 0, 0, 0, 0 };
+	SDL_Texture* texture = nullptr;
+	bool valid = false;
+	// Recorded between begin() and end() into the texture
+	bool drawing = false;
+	int redraws = 0;
+
+public:
+	CachedPanel() = default;
+	~CachedPanel() = default;
+
+	// Call before create_texture()
+	void set_rect(const SDL_Rect& rect) { this->rect = rect; }
+	// The content changed, it is drawn again on the next begin()
+	void invalidate() { valid = false; }
+
+	void create_texture(SDL_Renderer* renderer);
+	void destroy();
+
+	// Returns whether the panel has to be drawn: record it inside get_area(), then call end().
+	// The commands go into the texture, or when it is still valid only its copy is recorded.
+	bool begin(RenderCommandList& commands);
+	// Composites the panel drawn since begin() back on the screen
+	void end(RenderCommandList& commands);
+
+	// Rectangle of the panel in the target it is being drawn into
+	SDL_Rect get_area() const { return drawing ? SDL_Rect{ 0, 0, rect.w, rect.h } : rect; }
+
+	// Times the panel was drawn again since the start, the other frames only copied it
+	int get_redraws() const { return redraws; }
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "DebugDraw.h"
+
+#ifdef DEBUG_DRAW
+
+#include <cmath>
+
+DebugDraw::DebugDraw()
+{
+	circle_x.resize(CIRCLE_SEGMENTS + 1);
+	circle_y.resize(CIRCLE_SEGMENTS + 1);
+	for (int i = 0; i <= CIRCLE_SEGMENTS; i++)
+	{
+		const double angle = 2.0 * M_PI * i / CIRCLE_SEGMENTS;
+		circle_x[i] = static_cast<float>(std::cos(angle));
+		circle_y[i] = static_cast<float>(std::sin(angle));
+	}
+}
+
+void DebugDraw::line(float x1, float y1, float x2, float y2, SDL_Color color)
+{
+	if (enabled && (x1 != x2 || y1 != y2))
+	{
+		lines.push_back({ x1, y1, x2, y2, color });
+	}
+}
+
+void DebugDraw::rect(const SDL_FRect& rect, SDL_Color color)
+{
+	if (enabled)
+	{
+		rects.push_back({ rect, color });
+	}
+}
+
+void DebugDraw::fill_rect(const SDL_FRect& rect, SDL_Color color)
+{
+	if (enabled)
+	{
+		fill_rects.push_back({ rect, color });
+	}
+}
+
+void DebugDraw::circle(float x, float y, float radius, SDL_Color color)
+{
+	if (enabled)
+	{
+		circles.push_back({ x, y, radius, color });
+	}
+}
+
+// Writes one quad, corners in order around it
+static inline void write_quad(float*& xy, SDL_Color*& colors, float x0, float y0, float x1, float y1, 
+	float x2, float y2, float x3, float y3, SDL_Color color)
+{
+	xy[0] = x0; xy[1] = y0;
+	xy[2] = x1; xy[3] = y1;
+	xy[4] = x2; xy[5] = y2;
+	xy[6] = x3; xy[7] = y3;
+	colors[0] = color;
+	colors[1] = color;
+	colors[2] = color;
+	colors[3] = color;
+	xy += 8;
+	colors += 4;
+}
+
+void DebugDraw::flush(RenderCommandList& commands, const SDL_Rect& camera)
+{
+	RenderVertices vertices = commands.add_quads(get_count());
+	if (vertices.xy)
+	{
+		float* xy = vertices.xy;
+		SDL_Color* colors = vertices.colors;
+		const float camera_x = static_cast<float>(camera.x);
+		const float camera_y = static_cast<float>(camera.y);
+
+		// Half a pixel on each side of the segment
+		for (const auto& line : lines)
+		{
+			const float dx = line.x2 - line.x1;
+			const float dy = line.y2 - line.y1;
+			const float inv_length = 0.5f / std::sqrt(dx * dx + dy * dy);
+			const float nx = -dy * inv_length;
+			const float ny = dx * inv_length;
+			const float x1 = line.x1 - camera_x;
+			const float y1 = line.y1 - camera_y;
+			const float x2 = line.x2 - camera_x;
+			const float y2 = line.y2 - camera_y;
+			write_quad(xy, colors, x1 + nx, y1 + ny, x2 + nx, y2 + ny, x2 - nx, y2 - ny, x1 - nx, y1 - ny, line.color);
+		}
+
+		// Edges inside the rectangle, they don't overlap at the corners
+		for (const auto& rect : rects)
+		{
+			const float x0 = rect.rect.x - camera_x;
+			const float y0 = rect.rect.y - camera_y;
+			const float x1 = x0 + rect.rect.w;
+			const float y1 = y0 + rect.rect.h;
+			write_quad(xy, colors, x0, y0, x1, y0, x1, y0 + 1, x0, y0 + 1, rect.color);
+			write_quad(xy, colors, x0, y1 - 1, x1, y1 - 1, x1, y1, x0, y1, rect.color);
+			write_quad(xy, colors, x0, y0 + 1, x0 + 1, y0 + 1, x0 + 1, y1 - 1, x0, y1 - 1, rect.color);
+			write_quad(xy, colors, x1 - 1, y0 + 1, x1, y0 + 1, x1, y1 - 1, x1 - 1, y1 - 1, rect.color);
+		}
+
+		for (const auto& rect : fill_rects)
+		{
+			const float x0 = rect.rect.x - camera_x;
+			const float y0 = rect.rect.y - camera_y;
+			const float x1 = x0 + rect.rect.w;
+			const float y1 = y0 + rect.rect.h;
+			write_quad(xy, colors, x0, y0, x1, y0, x1, y1, x0, y1, rect.color);
+		}
+
+		// Ring between radius - 0.5 and radius + 0.5
+		for (const auto& circle : circles)
+		{
+			const float x = circle.x - camera_x;
+			const float y = circle.y - camera_y;
+			const float inner = circle.radius - 0.5f;
+			const float outer = circle.radius + 0.5f;
+			for (int i = 0; i < CIRCLE_SEGMENTS; i++)
+			{
+				write_quad(xy, colors, 
+					x + circle_x[i] * outer, y + circle_y[i] * outer, 
+					x + circle_x[i + 1] * outer, y + circle_y[i + 1] * outer, 
+					x + circle_x[i + 1] * inner, y + circle_y[i + 1] * inner, 
+					x + circle_x[i] * inner, y + circle_y[i] * inner, 
+					circle.color);
+			}
+		}
+	}
+
+	lines.clear();
+	rects.clear();
+	fill_rects.clear();
+	circles.clear();
+}
+
+#endif
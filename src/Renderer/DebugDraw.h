@@ -0,0 +1,100 @@
+#ifndef DEBUGDRAW_H
+#define DEBUGDRAW_H
+
+#include "RenderCommandList.h"
+
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// DebugDraw
+////////////////////////////////////////////////////////////////////////////////
+// Lines, rectangles and circles in world space to visualize collision boxes,
+// grid cells or paths. The primitives are only stored as they are added; flush()
+// turns all of them into 1 pixel wide quads written straight into the command
+// list, a single geometry command for the frame.
+// Only built with DEBUG_DRAW defined; otherwise every call is an empty inline
+// function and is_enabled() is constant false, so the code drawing them is
+// compiled out too.
+////////////////////////////////////////////////////////////////////////////////
+#ifdef DEBUG_DRAW
+
+class DebugDraw
+{
+private:
+	static const int CIRCLE_SEGMENTS = 32;
+
+	struct Line
+	{
+		float x1, y1, x2, y2;
+		SDL_Color color;
+	};
+	struct Rect
+	{
+		SDL_FRect rect;
+		SDL_Color color;
+	};
+	struct Circle
+	{
+		float x, y, radius;
+		SDL_Color color;
+	};
+
+	bool enabled = false;
+	// Added since the last flush, in world space. They only grow.
+	std::vector<Line> lines;
+	std::vector<Rect> rects;
+	std::vector<Rect> fill_rects;
+	std::vector<Circle> circles;
+	// Unit circle, CIRCLE_SEGMENTS + 1 points
+	std::vector<float> circle_x;
+	std::vector<float> circle_y;
+
+public:
+	DebugDraw();
+	~DebugDraw() = default;
+
+	void set_enabled(bool enabled) { this->enabled = enabled; }
+	void toggle() { enabled = !enabled; }
+	bool is_enabled() const { return enabled; }
+
+	// Primitives added while disabled are dropped
+	void line(float x1, float y1, float x2, float y2, SDL_Color color);
+	void rect(const SDL_FRect& rect, SDL_Color color);
+	void fill_rect(const SDL_FRect& rect, SDL_Color color);
+	void circle(float x, float y, float radius, SDL_Color color);
+
+	// Records everything added since the last flush, relative to the camera, and starts over
+	void flush(RenderCommandList& commands, const SDL_Rect& camera);
+
+	// Quads the next flush will record
+	int get_count() const 
+	{
+		return static_cast<int>(lines.size() + rects.size() * 4 + fill_rects.size() + circles.size() * CIRCLE_SEGMENTS);
+	}
+};
+
+#else
+
+class DebugDraw
+{
+public:
+	void set_enabled(bool) {}
+	void toggle() {}
+	constexpr bool is_enabled() const { return false; }
+
+	void line(float, float, float, float, SDL_Color) {}
+	void rect(const SDL_FRect&, SDL_Color) {}
+	void fill_rect(const SDL_FRect&, SDL_Color) {}
+	void circle(float, float, float, SDL_Color) {}
+
+	void flush(RenderCommandList&, const SDL_Rect&) {}
+
+	int get_count() const { return 0; }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,63 @@
+#include "DirtyRegions.h"
+
+void DirtyRegions::clear() 
+{
+	rects.clear();
+	full = false;
+}
+
+void DirtyRegions::add(const SDL_Rect& rect) 
+{
+	if (full || rect.w <= 0 || rect.h <= 0) 
+	{
+		return;
+	}
+
+	// Absorb every rectangle the new one overlaps, the grown one may now overlap others
+	SDL_Rect merged = rect;
+	for (size_t i = 0; i < rects.size();) 
+	{
+		if (SDL_HasIntersection(&merged, &rects[i])) 
+		{
+			SDL_UnionRect(&merged, &rects[i], &merged);
+			rects[i] = rects.back();
+			rects.pop_back();
+			i = 0;
+			continue;
+		}
+		i++;
+	}
+	rects.push_back(merged);
+
+	if (static_cast<int>(rects.size()) > MAX_RECTS) 
+	{
+		full = true;
+	}
+}
+
+void DirtyRegions::finish(const SDL_Rect& bounds) 
+{
+	if (!full) 
+	{
+		long long area = 0;
+		size_t kept = 0;
+		for (const auto& rect : rects) 
+		{
+			SDL_Rect clipped;
+			if (SDL_IntersectRect(&rect, &bounds, &clipped)) 
+			{
+				rects[kept++] = clipped;
+				area += static_cast<long long>(clipped.w) * clipped.h;
+			}
+		}
+		rects.resize(kept);
+
+		// Past half of the screen, the clipping and the overdraw at the edges cost more than they save
+		full = area * 2 > static_cast<long long>(bounds.w) * bounds.h;
+	}
+
+	if (full) 
+	{
+		rects.assign(1, bounds);
+	}
+}
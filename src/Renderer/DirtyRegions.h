@@ -0,0 +1,41 @@
+#ifndef DIRTYREGIONS_H
+#define DIRTYREGIONS_H
+
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// DirtyRegions
+////////////////////////////////////////////////////////////////////////////////
+// Areas of the world that changed since the last frame and have to be drawn
+// again. Overlapping rectangles are merged as they are added; when there are
+// too many of them, or they cover most of the screen, a single rectangle over
+// the whole screen is cheaper than redrawing them one by one.
+////////////////////////////////////////////////////////////////////////////////
+class DirtyRegions 
+{
+private:
+	static constexpr int MAX_RECTS = 16;
+
+	std::vector<SDL_Rect> rects;
+	bool full = false;
+
+public:
+	DirtyRegions() = default;
+	~DirtyRegions() = default;
+
+	void clear();
+	void add(const SDL_Rect& rect);
+	// Everything is redrawn this frame
+	void invalidate() { full = true; }
+
+	// Clips the rectangles to the bounds, or replaces them with the bounds when it doesn't pay off
+	void finish(const SDL_Rect& bounds);
+
+	const std::vector<SDL_Rect>& get_rects() const { return rects; }
+	bool is_full() const { return full; }
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "FontAtlas.h"
+#include "../Logger/Logger.h"
+
+bool FontAtlas::build(SDL_Renderer* renderer, TTF_Font* font) 
+{
+	line_height = TTF_FontLineSkip(font);
+
+	// Rasterize every glyph first, then lay them out in rows (shelves) of ATLAS_WIDTH pixels
+	const SDL_Color white = { 255, 255, 255, 255 };
+	SDL_Surface* glyph_surfaces[LAST_CHAR - FIRST_CHAR + 1]{};
+	int pen_x = 0;
+	int pen_y = 0;
+	int row_height = 0;
+
+	for (int c = FIRST_CHAR; c <= LAST_CHAR; c++) 
+	{
+		Glyph& glyph = glyphs[c - FIRST_CHAR];
+		int min_x, max_x, min_y, max_y;
+		TTF_GlyphMetrics(font, c, &min_x, &max_x, &min_y, &max_y, &glyph.advance);
+
+		SDL_Surface* surface = TTF_RenderGlyph_Blended(font, c, white);
+		glyph_surfaces[c - FIRST_CHAR] = surface;
+		if (!surface) 
+		{
+			glyph.src_rect = { 0, 0, 0, 0 };
+			continue;
+		}
+
+		if (pen_x + surface->w > ATLAS_WIDTH) 
+		{
+			pen_x = 0;
+			pen_y += row_height + 1;
+			row_height = 0;
+		}
+		glyph.src_rect = { pen_x, pen_y, surface->w, surface->h };
+		pen_x += surface->w + 1;
+		if (surface->h > row_height) 
+		{
+			row_height = surface->h;
+		}
+	}
+
+	SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, ATLAS_WIDTH, pen_y + row_height, 32, SDL_PIXELFORMAT_RGBA32);
+	for (int c = FIRST_CHAR; c <= LAST_CHAR; c++) 
+	{
+		SDL_Surface* surface = glyph_surfaces[c - FIRST_CHAR];
+		if (!surface) 
+		{
+			continue;
+		}
+		if (atlas) 
+		{
+			// Copy the glyph as is, alpha included, instead of blending it over the empty atlas
+			SDL_Rect dst_rect = glyphs[c - FIRST_CHAR].src_rect;
+			SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+			SDL_BlitSurface(surface, NULL, atlas, &dst_rect);
+		}
+		SDL_FreeSurface(surface);
+	}
+	if (!atlas) 
+	{
+		Logger::Err("Error creating the font atlas surface");
+		return false;
+	}
+
+	texture = SDL_CreateTextureFromSurface(renderer, atlas);
+	SDL_FreeSurface(atlas);
+	if (!texture) 
+	{
+		Logger::Err("Error creating the font atlas texture");
+		return false;
+	}
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+	return true;
+}
+
+void FontAtlas::destroy() 
+{
+	SDL_DestroyTexture(texture);
+	texture = nullptr;
+}
+
+const Glyph& FontAtlas::get_glyph(char c) const 
+{
+	if (c < FIRST_CHAR || c > LAST_CHAR) 
+	{
+		c = '?';
+	}
+	return glyphs[c - FIRST_CHAR];
+}
+
+int FontAtlas::measure(const char* text) const 
+{
+	int width = 0;
+	for (const char* c = text; *c; c++) 
+	{
+		width += get_glyph(*c).advance;
+	}
+	return width;
+}
+
+void FontAtlas::draw(RenderCommandList& commands, const char* text, float x, float y, SDL_Color color) const 
+{
+	float pen_x = x;
+	float pen_y = y;
+	for (const char* c = text; *c; c++) 
+	{
+		if (*c == '\n') 
+		{
+			pen_x = x;
+			pen_y += line_height;
+			continue;
+		}
+		const Glyph& glyph = get_glyph(*c);
+		if (glyph.src_rect.w > 0) 
+		{
+			SDL_FRect dst_rect = { pen_x, pen_y, static_cast<float>(glyph.src_rect.w), static_cast<float>(glyph.src_rect.h) };
+			commands.draw(texture, glyph.src_rect, dst_rect, 0.0, color);
+		}
+		pen_x += glyph.advance;
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef FONTATLAS_H
+#define FONTATLAS_H
+
+#include "RenderCommandList.h"
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// FontAtlas
+////////////////////////////////////////////////////////////////////////////////
+// The printable ASCII glyphs of a font (at one size) rasterized once into a
+// single white texture. Strings are recorded as one quad per glyph, batched
+// when the command list is executed and tinted with the vertex color, so
+// drawing text creates no surfaces or textures.
+////////////////////////////////////////////////////////////////////////////////
+struct Glyph 
+{
+	SDL_Rect src_rect;
+	int advance;
+};
+
+class FontAtlas 
+{
+private:
+	static const int FIRST_CHAR = 32;
+	static const int LAST_CHAR = 126;
+	static const int ATLAS_WIDTH = 512;
+
+	SDL_Texture* texture = nullptr;
+	Glyph glyphs[LAST_CHAR - FIRST_CHAR + 1]{};
+	int line_height = 0;
+
+public:
+	FontAtlas() = default;
+	~FontAtlas() = default;
+
+	bool build(SDL_Renderer* renderer, TTF_Font* font);
+	void destroy();
+
+	const Glyph& get_glyph(char c) const;
+	int get_line_height() const { return line_height; }
+	SDL_Texture* get_texture() const { return texture; }
+
+	// Width in pixels of a string drawn with this font
+	int measure(const char* text) const;
+
+	// Queues the quads of a string, (x, y) is the top left corner of the first line
+	void draw(RenderCommandList& commands, const char* text, float x, float y, SDL_Color color) const;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "FrameCapture.h"
+#include "../Logger/Logger.h"
+
+#include <SDL2/SDL_image.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+void FrameCapture::set_frames(const std::string& frame_list) 
+{
+	frames.clear();
+	size_t start = 0;
+	while (start < frame_list.size()) 
+	{
+		size_t end = frame_list.find(',', start);
+		if (end == std::string::npos) 
+		{
+			end = frame_list.size();
+		}
+		if (end > start) 
+		{
+			frames.push_back(std::atoi(frame_list.substr(start, end - start).c_str()));
+		}
+		start = end + 1;
+	}
+	std::sort(frames.begin(), frames.end());
+}
+
+bool FrameCapture::wants(int frame) const 
+{
+	return std::binary_search(frames.begin(), frames.end(), frame);
+}
+
+std::string FrameCapture::file_name(int frame) const 
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "frame_%05d.%s", frame, raw ? "rgba" : "png");
+	return name;
+}
+
+SDL_Surface* FrameCapture::load_golden(int frame, int width, int height) const 
+{
+	const std::string path = golden_dir + "/" + file_name(frame);
+	if (!raw) 
+	{
+		SDL_Surface* image = IMG_Load(path.c_str());
+		if (!image) 
+		{
+			return nullptr;
+		}
+		SDL_Surface* golden = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_RGBA32, 0);
+		SDL_FreeSurface(image);
+		return golden;
+	}
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file) 
+	{
+		return nullptr;
+	}
+	SDL_Surface* golden = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+	for (int y = 0; golden && y < height; y++) 
+	{
+		file.read(static_cast<char*>(golden->pixels) + y * golden->pitch, width * 4);
+	}
+	return golden;
+}
+
+void FrameCapture::capture(SDL_Renderer* renderer, int frame, double render_ms) 
+{
+	int width = 0, height = 0;
+	SDL_GetRendererOutputSize(renderer, &width, &height);
+	SDL_Surface* pixels = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+	if (!pixels || SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_RGBA32, pixels->pixels, pixels->pitch) != 0) 
+	{
+		Logger::Err("Error reading frame " + std::to_string(frame) + " back: " + SDL_GetError());
+		SDL_FreeSurface(pixels);
+		failures++;
+		return;
+	}
+
+	// Write the frame
+	std::filesystem::create_directories(output_dir);
+	const std::string path = output_dir + "/" + file_name(frame);
+	if (raw) 
+	{
+		std::ofstream file(path, std::ios::binary);
+		for (int y = 0; y < height; y++) 
+		{
+			file.write(static_cast<const char*>(pixels->pixels) + y * pixels->pitch, width * 4);
+		}
+	}
+	else if (IMG_SavePNG(pixels, path.c_str()) != 0) 
+	{
+		Logger::Err("Error writing " + path + ": " + IMG_GetError());
+	}
+
+	std::string report = "Frame " + std::to_string(frame) + ": render " + std::to_string(render_ms) + " ms";
+
+	// Compare it against the golden image
+	if (!golden_dir.empty()) 
+	{
+		SDL_Surface* golden = load_golden(frame, width, height);
+		if (!golden || golden->w != width || golden->h != height) 
+		{
+			Logger::Err(report + ", no golden image of the same size for it");
+			SDL_FreeSurface(golden);
+			SDL_FreeSurface(pixels);
+			failures++;
+			return;
+		}
+
+		int different_pixels = 0;
+		int max_difference = 0;
+		for (int y = 0; y < height; y++) 
+		{
+			const Uint8* row = static_cast<const Uint8*>(pixels->pixels) + y * pixels->pitch;
+			const Uint8* golden_row = static_cast<const Uint8*>(golden->pixels) + y * golden->pitch;
+			for (int x = 0; x < width; x++) 
+			{
+				int pixel_difference = 0;
+				for (int channel = 0; channel < 4; channel++) 
+				{
+					pixel_difference = std::max(pixel_difference, std::abs(row[x * 4 + channel] - golden_row[x * 4 + channel]));
+				}
+				max_difference = std::max(max_difference, pixel_difference);
+				if (pixel_difference > tolerance) 
+				{
+					different_pixels++;
+				}
+			}
+		}
+		SDL_FreeSurface(golden);
+
+		report += ", " + std::to_string(different_pixels) + " pixels over the tolerance, max difference " + std::to_string(max_difference);
+		if (different_pixels > 0) 
+		{
+			Logger::Err(report);
+			failures++;
+		}
+		else 
+		{
+			Logger::Log(report);
+		}
+	}
+	else 
+	{
+		Logger::Log(report + ", written to " + path);
+	}
+
+	SDL_FreeSurface(pixels);
+}
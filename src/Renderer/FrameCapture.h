@@ -0,0 +1,54 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <string>
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// FrameCapture
+////////////////////////////////////////////////////////////////////////////////
+// Reads selected frames back from the renderer, writes them as PNG or raw
+// RGBA files and compares them against golden images of the same name. A
+// pixel differs when one of its channels is further than the tolerance from
+// the golden one. Meant for headless runs, where the virtual clock makes the
+// frames of two runs identical and the surface keeps the presented image.
+////////////////////////////////////////////////////////////////////////////////
+class FrameCapture 
+{
+private:
+	// Sorted frame indices
+	std::vector<int> frames;
+	std::string output_dir = "./captures";
+	std::string golden_dir;
+	int tolerance = 0;
+	bool raw = false;
+	int failures = 0;
+
+	std::string file_name(int frame) const;
+	// Golden pixels as RGBA, nullptr when there is no golden image for the frame
+	SDL_Surface* load_golden(int frame, int width, int height) const;
+
+public:
+	FrameCapture() = default;
+	~FrameCapture() = default;
+
+	// Comma separated frame indices, "0,60,120"
+	void set_frames(const std::string& frame_list);
+	void set_output_dir(const std::string& dir) { output_dir = dir; }
+	void set_golden_dir(const std::string& dir) { golden_dir = dir; }
+	void set_tolerance(int tolerance) { this->tolerance = tolerance; }
+	// Raw RGBA files instead of PNG, width * height * 4 bytes
+	void set_raw(bool raw) { this->raw = raw; }
+
+	bool wants(int frame) const;
+
+	// Called on the render thread once the frame has been presented
+	void capture(SDL_Renderer* renderer, int frame, double render_ms);
+
+	int get_failures() const { return failures; }
+};
+
+#endif
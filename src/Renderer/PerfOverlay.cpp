@@ -0,0 +1,179 @@
+#include "PerfOverlay.h"
+#include "../Logger/Logger.h"
+
+#include <imgui/imgui.h>
+
+#include <cstdio>
+#include <string>
+
+void PerfOverlay::initialize(int width, int height) 
+{
+	ImGui::CreateContext();
+	ImGuiIO& io = ImGui::GetIO();
+	io.DisplaySize = ImVec2(static_cast<float>(width), static_cast<float>(height));
+	// Nothing to remember between runs
+	io.IniFilename = nullptr;
+	io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+	initialized = true;
+}
+
+void PerfOverlay::shutdown() 
+{
+	if (initialized) 
+	{
+		ImGui::DestroyContext();
+		initialized = false;
+	}
+}
+
+void PerfOverlay::create_font_texture(SDL_Renderer* renderer) 
+{
+	if (!initialized) 
+	{
+		return;
+	}
+
+	unsigned char* pixels = nullptr;
+	int width = 0, height = 0;
+	ImGuiIO& io = ImGui::GetIO();
+	io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+	font_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, width, height);
+	if (!font_texture) 
+	{
+		Logger::Err("Error creating the overlay font texture: " + std::string(SDL_GetError()));
+		return;
+	}
+	SDL_UpdateTexture(font_texture, NULL, pixels, width * 4);
+	SDL_SetTextureBlendMode(font_texture, SDL_BLENDMODE_BLEND);
+	io.Fonts->TexID = font_texture;
+}
+
+void PerfOverlay::destroy_font_texture() 
+{
+	SDL_DestroyTexture(font_texture);
+	font_texture = nullptr;
+}
+
+Uint64 PerfOverlay::add_system_time(const char* name, Uint64 start) 
+{
+	const Uint64 now = SDL_GetPerformanceCounter();
+	const double ms = static_cast<double>(now - start) * 1000.0 / SDL_GetPerformanceFrequency();
+
+	// A handful of systems, found by the address of their name
+	for (auto& system_time : system_times) 
+	{
+		if (system_time.name == name) 
+		{
+			system_time.ms += ms;
+			return now;
+		}
+	}
+	system_times.push_back({ name, ms });
+	return now;
+}
+
+void PerfOverlay::end_frame(double frame_ms, double render_ms) 
+{
+	this->frame_ms[history_index] = static_cast<float>(frame_ms);
+	this->render_ms[history_index] = static_cast<float>(render_ms);
+	history_index = (history_index + 1) % HISTORY_SIZE;
+
+	shown_system_times = system_times;
+	for (auto& system_time : system_times) 
+	{
+		system_time.ms = 0.0;
+	}
+}
+
+void PerfOverlay::render(RenderCommandList& commands, const PerfStats& stats, double dt) 
+{
+	if (!visible || !font_texture) 
+	{
+		return;
+	}
+
+	ImGuiIO& io = ImGui::GetIO();
+	io.DeltaTime = dt > 0.0 ? static_cast<float>(dt) : 1.0f / 60.0f;
+	ImGui::NewFrame();
+
+	const ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoInputs | 
+		ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav;
+	ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x - 10.0f, 10.0f), ImGuiCond_Always, ImVec2(1.0f, 0.0f));
+	ImGui::SetNextWindowBgAlpha(0.6f);
+	ImGui::Begin("Performance", nullptr, flags);
+
+	ImGui::Text("Draw calls:       %d", stats.draw_calls);
+	ImGui::Text("Texture switches: %d", stats.texture_switches);
+	ImGui::Text("Sprites:          %d drawn, %d culled", stats.sprites_drawn, stats.sprites_total - stats.sprites_drawn);
+	ImGui::Text("Particles:        %d", stats.particles);
+	ImGui::Separator();
+
+	// The newest value is the one before the write position
+	const int last = (history_index + HISTORY_SIZE - 1) % HISTORY_SIZE;
+	char label[64];
+	std::snprintf(label, sizeof(label), "frame %.2f ms", frame_ms[last]);
+	ImGui::PlotHistogram("##frame", frame_ms, HISTORY_SIZE, history_index, label, 0.0f, 33.3f, ImVec2(260.0f, 50.0f));
+	std::snprintf(label, sizeof(label), "render %.2f ms", render_ms[last]);
+	ImGui::PlotHistogram("##render", render_ms, HISTORY_SIZE, history_index, label, 0.0f, 33.3f, ImVec2(260.0f, 50.0f));
+	ImGui::Separator();
+
+	for (const auto& system_time : shown_system_times) 
+	{
+		ImGui::Text("%-18s %7.3f ms", system_time.name, system_time.ms);
+	}
+
+	ImGui::End();
+	ImGui::Render();
+	record(commands, ImGui::GetDrawData());
+}
+
+void PerfOverlay::record(RenderCommandList& commands, const ImDrawData* draw_data) const 
+{
+	commands.begin_overlay();
+
+	const ImVec2 origin = draw_data->DisplayPos;
+	for (int list_index = 0; list_index < draw_data->CmdListsCount; list_index++) 
+	{
+		const ImDrawList* draw_list = draw_data->CmdLists[list_index];
+		const ImDrawVert* vertices = draw_list->VtxBuffer.Data;
+		const ImDrawIdx* indices = draw_list->IdxBuffer.Data;
+
+		for (const ImDrawCmd& draw_cmd : draw_list->CmdBuffer) 
+		{
+			if (draw_cmd.UserCallback || draw_cmd.ElemCount == 0) 
+			{
+				continue;
+			}
+
+			const SDL_Rect clip = {
+				static_cast<int>(draw_cmd.ClipRect.x - origin.x),
+				static_cast<int>(draw_cmd.ClipRect.y - origin.y),
+				static_cast<int>(draw_cmd.ClipRect.z - draw_cmd.ClipRect.x),
+				static_cast<int>(draw_cmd.ClipRect.w - draw_cmd.ClipRect.y)
+			};
+			commands.set_clip(clip);
+
+			// Unindexed, every index gets its own vertex: ImGui's vertices are shared by the whole list
+			const int count = static_cast<int>(draw_cmd.ElemCount);
+			RenderTriangleData triangles = commands.add_triangles(static_cast<SDL_Texture*>(draw_cmd.TextureId), count, count);
+			for (int i = 0; i < count; i++) 
+			{
+				const ImDrawVert& vertex = vertices[draw_cmd.VtxOffset + indices[draw_cmd.IdxOffset + i]];
+				triangles.vertices[i] = {
+					{ vertex.pos.x - origin.x, vertex.pos.y - origin.y },
+					{ 
+						static_cast<Uint8>(vertex.col >> IM_COL32_R_SHIFT), 
+						static_cast<Uint8>(vertex.col >> IM_COL32_G_SHIFT), 
+						static_cast<Uint8>(vertex.col >> IM_COL32_B_SHIFT), 
+						static_cast<Uint8>(vertex.col >> IM_COL32_A_SHIFT) 
+					},
+					{ vertex.uv.x, vertex.uv.y }
+				};
+				triangles.indices[i] = i;
+			}
+		}
+	}
+
+	commands.reset_clip();
+}
@@ -0,0 +1,81 @@
+#ifndef PERFOVERLAY_H
+#define PERFOVERLAY_H
+
+#include "RenderCommandList.h"
+
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+struct ImDrawData;
+
+// Numbers of the last frame shown by the overlay
+struct PerfStats 
+{
+	int draw_calls = 0;
+	int texture_switches = 0;
+	int sprites_drawn = 0;
+	int sprites_total = 0;
+	int particles = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// PerfOverlay
+////////////////////////////////////////////////////////////////////////////////
+// ImGui window with the render statistics, a histogram of the frame times and
+// the time spent in each system. The ImGui draw data is recorded after the
+// frame's commands as an overlay: one SDL_RenderGeometry call per ImGui draw
+// command, left out of the draw calls and the render time it displays.
+// Hidden, it only costs the system timings.
+////////////////////////////////////////////////////////////////////////////////
+class PerfOverlay 
+{
+private:
+	static constexpr int HISTORY_SIZE = 120;
+
+	bool visible = false;
+	bool initialized = false;
+	SDL_Texture* font_texture = nullptr;
+
+	// Ring buffers of the last frame times, in milliseconds
+	float frame_ms[HISTORY_SIZE] = {};
+	float render_ms[HISTORY_SIZE] = {};
+	int history_index = 0;
+
+	struct SystemTime 
+	{
+		const char* name;
+		double ms;
+	};
+	// Summed over the simulation steps of the frame being run, and the ones of the last frame
+	std::vector<SystemTime> system_times;
+	std::vector<SystemTime> shown_system_times;
+
+	void record(RenderCommandList& commands, const ImDrawData* draw_data) const;
+
+public:
+	PerfOverlay() = default;
+	~PerfOverlay() = default;
+
+	// Creates the ImGui context for an output of width x height
+	void initialize(int width, int height);
+	void shutdown();
+	// Uploads the ImGui font, on the thread that owns the renderer
+	void create_font_texture(SDL_Renderer* renderer);
+	void destroy_font_texture();
+
+	void set_visible(bool visible) { this->visible = visible; }
+	void toggle() { visible = !visible; }
+
+	// Adds the time since start, a performance counter value, to the system.
+	// Returns the current counter, so the timings of consecutive systems can be chained.
+	Uint64 add_system_time(const char* name, Uint64 start);
+	// Stores the times of the frame that just ended
+	void end_frame(double frame_ms, double render_ms);
+
+	// Records the overlay at the end of the frame's commands
+	void render(RenderCommandList& commands, const PerfStats& stats, double dt);
+};
+
+#endif
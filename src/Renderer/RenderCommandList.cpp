@@ -0,0 +1,255 @@
+#include "RenderCommandList.h"
+
+#include <algorithm>
+
+void RenderCommandList::clear(SDL_Color color) 
+{
+	RenderCommand command;
+	command.type = RenderCommandType::CLEAR;
+	command.texture = nullptr;
+	command.color = color;
+	commands.push_back(command);
+}
+
+void RenderCommandList::set_target(SDL_Texture* texture) 
+{
+	RenderCommand command;
+	command.type = RenderCommandType::SET_TARGET;
+	command.texture = texture;
+	commands.push_back(command);
+}
+
+void RenderCommandList::set_clip(const SDL_Rect& rect) 
+{
+	RenderCommand command;
+	command.type = RenderCommandType::SET_CLIP;
+	command.texture = nullptr;
+	command.dst_rect = rect;
+	commands.push_back(command);
+}
+
+void RenderCommandList::reset_clip() 
+{
+	set_clip({ 0, 0, 0, 0 });
+}
+
+void RenderCommandList::fill(const SDL_Rect& rect, SDL_Color color) 
+{
+	RenderCommand command;
+	command.type = RenderCommandType::FILL;
+	command.texture = nullptr;
+	command.fill = { rect, color };
+	commands.push_back(command);
+}
+
+void RenderCommandList::copy(SDL_Texture* texture, const SDL_Rect& dst_rect) 
+{
+	RenderCommand command;
+	command.type = RenderCommandType::COPY;
+	command.texture = texture;
+	command.dst_rect = dst_rect;
+	commands.push_back(command);
+}
+
+void RenderCommandList::draw(SDL_Texture* texture, const SDL_Rect& src_rect, const SDL_FRect& dst_rect, double angle, SDL_Color color) 
+{
+	RenderCommand command;
+	command.type = RenderCommandType::QUAD;
+	command.texture = texture;
+	command.quad = { src_rect, dst_rect, static_cast<float>(angle), color };
+	commands.push_back(command);
+}
+
+RenderVertices RenderCommandList::add_quads(int num_quads) 
+{
+	if (num_quads <= 0) 
+	{
+		return { nullptr, nullptr };
+	}
+
+	const int first_vertex = num_vertices;
+	num_vertices += num_quads * 4;
+	if (static_cast<size_t>(num_vertices) > geometry_colors.size()) 
+	{
+		geometry_xy.resize(num_vertices * 2);
+		geometry_colors.resize(num_vertices);
+	}
+
+	const int num_indices = num_quads * 6;
+	for (int quad = static_cast<int>(quad_indices.size()) / 6; quad * 6 < num_indices; quad++) 
+	{
+		const int vertex = quad * 4;
+		quad_indices.insert(quad_indices.end(), { vertex, vertex + 1, vertex + 2, vertex, vertex + 2, vertex + 3 });
+	}
+
+	RenderCommand command;
+	command.type = RenderCommandType::GEOMETRY;
+	command.texture = nullptr;
+	command.geometry = { first_vertex, num_quads };
+	commands.push_back(command);
+
+	return { &geometry_xy[first_vertex * 2], &geometry_colors[first_vertex] };
+}
+
+RenderTriangleData RenderCommandList::add_triangles(SDL_Texture* texture, int num_vertices, int num_indices) 
+{
+	if (num_vertices <= 0 || num_indices <= 0) 
+	{
+		return { nullptr, nullptr };
+	}
+
+	const int first_vertex = num_triangle_vertices;
+	const int first_index = num_triangle_indices;
+	num_triangle_vertices += num_vertices;
+	num_triangle_indices += num_indices;
+	if (static_cast<size_t>(num_triangle_vertices) > triangle_vertices.size()) 
+	{
+		triangle_vertices.resize(num_triangle_vertices);
+	}
+	if (static_cast<size_t>(num_triangle_indices) > triangle_indices.size()) 
+	{
+		triangle_indices.resize(num_triangle_indices);
+	}
+
+	RenderCommand command;
+	command.type = RenderCommandType::TRIANGLES;
+	command.texture = texture;
+	command.triangles = { first_vertex, num_vertices, first_index, num_indices };
+	commands.push_back(command);
+
+	return { &triangle_vertices[first_vertex], &triangle_indices[first_index] };
+}
+
+Uint32* RenderCommandList::update_texture(SDL_Texture* texture, const SDL_Rect& rect) 
+{
+	if (!texture || rect.w <= 0 || rect.h <= 0) 
+	{
+		return nullptr;
+	}
+
+	const int first_byte = num_update_bytes;
+	num_update_bytes += rect.w * rect.h * 4;
+	if (static_cast<size_t>(num_update_bytes) > update_pixels.size()) 
+	{
+		update_pixels.resize(num_update_bytes);
+	}
+
+	RenderCommand command;
+	command.type = RenderCommandType::UPDATE;
+	command.texture = texture;
+	command.update = { rect, first_byte };
+	commands.push_back(command);
+
+	return reinterpret_cast<Uint32*>(&update_pixels[first_byte]);
+}
+
+void RenderCommandList::execute(SDL_Renderer* renderer, SpriteBatch& batch, bool batched, RenderStats* stats) const 
+{
+	execute_range(renderer, batch, batched, 0, std::min(overlay_start, commands.size()), stats);
+}
+
+void RenderCommandList::execute_overlay(SDL_Renderer* renderer, SpriteBatch& batch) const 
+{
+	if (overlay_start < commands.size()) 
+	{
+		execute_range(renderer, batch, true, overlay_start, commands.size(), nullptr);
+	}
+}
+
+void RenderCommandList::execute_range(SDL_Renderer* renderer, SpriteBatch& batch, bool batched, size_t begin, size_t end, RenderStats* stats) const 
+{
+	batch.begin(renderer);
+
+	// Counted as they are submitted, the batched quads are counted by the batch
+	int draw_calls = 0;
+	int texture_switches = 0;
+	const SDL_Texture* last_texture = nullptr;
+
+	for (size_t i = begin; i < end; i++) 
+	{
+		const RenderCommand& command = commands[i];
+		if (command.type == RenderCommandType::QUAD || command.type == RenderCommandType::COPY || 
+			command.type == RenderCommandType::GEOMETRY || command.type == RenderCommandType::TRIANGLES) 
+		{
+			if (command.texture != last_texture) 
+			{
+				texture_switches++;
+				last_texture = command.texture;
+			}
+		}
+
+		if (command.type == RenderCommandType::QUAD && batched) 
+		{
+			batch.draw(command.texture, command.quad.src_rect, command.quad.dst_rect, command.quad.angle, command.quad.color);
+			continue;
+		}
+		if (command.type == RenderCommandType::QUAD) 
+		{
+			const RenderQuad& quad = command.quad;
+			SDL_SetTextureColorMod(command.texture, quad.color.r, quad.color.g, quad.color.b);
+			SDL_SetTextureAlphaMod(command.texture, quad.color.a);
+			SDL_RenderCopyExF(renderer, command.texture, &quad.src_rect, &quad.dst_rect, quad.angle, NULL, SDL_FLIP_NONE);
+			SDL_SetTextureColorMod(command.texture, 255, 255, 255);
+			SDL_SetTextureAlphaMod(command.texture, 255);
+			draw_calls++;
+			continue;
+		}
+
+		// Anything else has to wait for the quads recorded before it
+		batch.flush();
+
+		switch (command.type) 
+		{
+		case RenderCommandType::CLEAR:
+			SDL_SetRenderDrawColor(renderer, command.color.r, command.color.g, command.color.b, command.color.a);
+			SDL_RenderClear(renderer);
+			draw_calls++;
+			break;
+		case RenderCommandType::SET_TARGET:
+			SDL_SetRenderTarget(renderer, command.texture);
+			break;
+		case RenderCommandType::SET_CLIP:
+			SDL_RenderSetClipRect(renderer, SDL_RectEmpty(&command.dst_rect) ? NULL : &command.dst_rect);
+			break;
+		case RenderCommandType::FILL:
+			SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+			SDL_SetRenderDrawColor(renderer, command.fill.color.r, command.fill.color.g, command.fill.color.b, command.fill.color.a);
+			SDL_RenderFillRect(renderer, &command.fill.rect);
+			draw_calls++;
+			break;
+		case RenderCommandType::COPY:
+			SDL_RenderCopy(renderer, command.texture, NULL, &command.dst_rect);
+			draw_calls++;
+			break;
+		case RenderCommandType::GEOMETRY:
+			// Untextured geometry blends with the draw blend mode, which FILL leaves at NONE
+			SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+			SDL_RenderGeometryRaw(renderer, NULL, 
+				&geometry_xy[command.geometry.first_vertex * 2], 2 * sizeof(float), 
+				&geometry_colors[command.geometry.first_vertex], sizeof(SDL_Color), 
+				NULL, 0, 
+				command.geometry.num_quads * 4, quad_indices.data(), command.geometry.num_quads * 6, sizeof(int));
+			draw_calls++;
+			break;
+		case RenderCommandType::TRIANGLES:
+			SDL_RenderGeometry(renderer, command.texture, 
+				&triangle_vertices[command.triangles.first_vertex], command.triangles.num_vertices, 
+				&triangle_indices[command.triangles.first_index], command.triangles.num_indices);
+			draw_calls++;
+			break;
+		case RenderCommandType::UPDATE:
+			SDL_UpdateTexture(command.texture, &command.update.rect, &update_pixels[command.update.first_byte], command.update.rect.w * 4);
+			break;
+		default:
+			break;
+		}
+	}
+
+	batch.end();
+
+	if (stats) 
+	{
+		stats->draw_calls = draw_calls + batch.get_draw_calls();
+		stats->texture_switches = texture_switches;
+	}
+}
@@ -0,0 +1,184 @@
+#ifndef RENDERCOMMANDLIST_H
+#define RENDERCOMMANDLIST_H
+
+#include "SpriteBatch.h"
+
+#include <cstdint>
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+enum class RenderCommandType 
+{
+	CLEAR,
+	SET_TARGET,
+	SET_CLIP,
+	FILL,
+	COPY,
+	QUAD,
+	GEOMETRY,
+	TRIANGLES,
+	UPDATE
+};
+
+struct RenderQuad 
+{
+	SDL_Rect src_rect;
+	SDL_FRect dst_rect;
+	float angle;
+	SDL_Color color;
+};
+
+struct RenderFill 
+{
+	SDL_Rect rect;
+	SDL_Color color;
+};
+
+// Untextured quads in the vertex arrays of the list, 4 vertices each
+struct RenderGeometry 
+{
+	int first_vertex;
+	int num_quads;
+};
+
+// Where the caller writes the vertices of the quads it added, 4 per quad:
+// xy holds 2 floats per vertex, colors one color per vertex
+struct RenderVertices 
+{
+	float* xy;
+	SDL_Color* colors;
+};
+
+// Textured triangles in the vertex and index arrays of the list, indices relative to first_vertex
+struct RenderTriangles 
+{
+	int first_vertex;
+	int num_vertices;
+	int first_index;
+	int num_indices;
+};
+
+// Where the caller writes the vertices and indices of the triangles it added
+struct RenderTriangleData 
+{
+	SDL_Vertex* vertices;
+	int* indices;
+};
+
+// Pixels uploaded to a streaming texture, rect.h rows of rect.w 32 bit pixels in the pixel array of the list
+struct RenderUpdate 
+{
+	SDL_Rect rect;
+	int first_byte;
+};
+
+// What executing a list submitted to the renderer
+struct RenderStats 
+{
+	int draw_calls = 0;
+	// Draws that used another texture than the one before
+	int texture_switches = 0;
+};
+
+struct RenderCommand 
+{
+	RenderCommandType type;
+	// Texture drawn or updated, or render target for SET_TARGET (nullptr is the screen)
+	SDL_Texture* texture;
+	union 
+	{
+		SDL_Color color;
+		// Copy destination, or clip rectangle for SET_CLIP (empty to disable clipping)
+		SDL_Rect dst_rect;
+		RenderFill fill;
+		RenderQuad quad;
+		RenderGeometry geometry;
+		RenderTriangles triangles;
+		RenderUpdate update;
+	};
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// RenderCommandList
+////////////////////////////////////////////////////////////////////////////////
+// Everything a frame draws, recorded by the game thread without touching the
+// renderer and executed later on the thread that owns it. Sprites and text
+// are recorded as quads; consecutive quads sharing a texture are submitted
+// with a single SpriteBatch draw call when the list is executed.
+////////////////////////////////////////////////////////////////////////////////
+class RenderCommandList 
+{
+private:
+	// Reused from frame to frame, they only grow
+	std::vector<RenderCommand> commands;
+	// Not cleared between frames, only the first num_vertices are used by the current one
+	std::vector<float> geometry_xy;
+	std::vector<SDL_Color> geometry_colors;
+	int num_vertices = 0;
+	// Same two triangles for every quad, relative to the first vertex of the command
+	std::vector<int> quad_indices;
+	std::vector<SDL_Vertex> triangle_vertices;
+	std::vector<int> triangle_indices;
+	int num_triangle_vertices = 0;
+	int num_triangle_indices = 0;
+	std::vector<Uint8> update_pixels;
+	int num_update_bytes = 0;
+
+	// Commands from this one on are the overlay, drawn over the frame and left out of its stats
+	size_t overlay_start = SIZE_MAX;
+
+	void execute_range(SDL_Renderer* renderer, SpriteBatch& batch, bool batched, size_t begin, size_t end, RenderStats* stats) const;
+
+public:
+	RenderCommandList() = default;
+	~RenderCommandList() = default;
+
+	void reset() 
+	{
+		commands.clear();
+		num_vertices = 0;
+		num_triangle_vertices = 0;
+		num_triangle_indices = 0;
+		num_update_bytes = 0;
+		overlay_start = SIZE_MAX;
+	}
+
+	// Fills the current target with the color, whatever the clip rectangle
+	void clear(SDL_Color color);
+	// Following commands draw into the texture, or the screen when it is nullptr
+	void set_target(SDL_Texture* texture);
+	// Following commands only draw inside the rectangle of the current target
+	void set_clip(const SDL_Rect& rect);
+	void reset_clip();
+	// Fills the rectangle with the color, no blending
+	void fill(const SDL_Rect& rect, SDL_Color color);
+	// Whole texture copied to dst_rect, without scaling when the sizes match
+	void copy(SDL_Texture* texture, const SDL_Rect& dst_rect);
+	// Same arguments as SpriteBatch::draw
+	void draw(SDL_Texture* texture, const SDL_Rect& src_rect, const SDL_FRect& dst_rect, double angle = 0.0, SDL_Color color = { 255, 255, 255, 255 });
+
+	// Untextured quads, alpha blended, submitted with a single SDL_RenderGeometryRaw call. The caller fills the returned
+	// arrays, which stay valid until the next command is recorded.
+	RenderVertices add_quads(int num_quads);
+	// Triangles submitted with a single SDL_RenderGeometry call, same rules as add_quads
+	RenderTriangleData add_triangles(SDL_Texture* texture, int num_vertices, int num_indices);
+
+	// Replaces the pixels of rect in the texture, with SDL_UpdateTexture when the list is executed.
+	// The caller writes the rect.h rows of rect.w pixels, without padding, same rules as add_quads.
+	Uint32* update_texture(SDL_Texture* texture, const SDL_Rect& rect);
+
+	// Everything recorded after this call is an overlay, like debug UI
+	void begin_overlay() { overlay_start = commands.size(); }
+
+	// Called on the thread that owns the renderer, executes the commands recorded before the overlay.
+	// Unbatched, every quad is its own SDL_RenderCopyExF, the reference the batched output is checked against.
+	void execute(SDL_Renderer* renderer, SpriteBatch& batch, bool batched = true, RenderStats* stats = nullptr) const;
+	// Executes the overlay commands, batched
+	void execute_overlay(SDL_Renderer* renderer, SpriteBatch& batch) const;
+
+	size_t size() const { return commands.size(); }
+};
+
+#endif
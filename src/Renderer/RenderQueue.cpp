@@ -0,0 +1,84 @@
+#include "RenderQueue.h"
+
+#include <utility>
+
+void RenderQueue::sort() 
+{
+	const size_t count = entries.size();
+	if (count < 2) 
+	{
+		return;
+	}
+
+	// Bits set in every key and in any key
+	uint32_t keys_and = ~0u;
+	uint32_t keys_or = 0;
+	for (uint64_t entry : entries) 
+	{
+		keys_and &= static_cast<uint32_t>(entry >> 32);
+		keys_or |= static_cast<uint32_t>(entry >> 32);
+	}
+	const uint32_t varying = keys_and ^ keys_or;
+	if (varying == 0) 
+	{
+		return;
+	}
+
+	// Bit where each digit starts, every one of them differs between some keys
+	int shifts[RADIX_DIGITS];
+	int num_digits = 0;
+	uint32_t uncovered = varying;
+	while (uncovered) 
+	{
+		int shift = 0;
+		while (!((uncovered >> shift) & 1)) 
+		{
+			shift++;
+		}
+		shifts[num_digits++] = shift;
+		uncovered = shift + RADIX_BITS >= 32 ? 0 : uncovered & ~((1u << (shift + RADIX_BITS)) - 1);
+	}
+
+	// Raw pointers, the compiler can't tell the stores into a vector don't move another one's data
+	sorted_entries.resize(count);
+	uint64_t* source = entries.data();
+	uint64_t* destination = sorted_entries.data();
+
+	// One histogram per digit, all filled in a single read of the keys
+	histogram.assign(num_digits * RADIX_BUCKETS, 0);
+	uint32_t* counts = histogram.data();
+	for (size_t i = 0; i < count; i++) 
+	{
+		const uint32_t key = static_cast<uint32_t>(source[i] >> 32);
+		for (int digit = 0; digit < num_digits; digit++) 
+		{
+			counts[digit * RADIX_BUCKETS + ((key >> shifts[digit]) & (RADIX_BUCKETS - 1))]++;
+		}
+	}
+
+	for (int digit = 0; digit < num_digits; digit++) 
+	{
+		uint32_t* offsets = counts + digit * RADIX_BUCKETS;
+		const int shift = 32 + shifts[digit];
+
+		uint32_t sum = 0;
+		for (int bucket = 0; bucket < RADIX_BUCKETS; bucket++) 
+		{
+			const uint32_t bucket_count = offsets[bucket];
+			offsets[bucket] = sum;
+			sum += bucket_count;
+		}
+
+		for (size_t i = 0; i < count; i++) 
+		{
+			const uint64_t entry = source[i];
+			destination[offsets[(entry >> shift) & (RADIX_BUCKETS - 1)]++] = entry;
+		}
+		std::swap(source, destination);
+	}
+
+	if (source != entries.data()) 
+	{
+		entries.swap(sorted_entries);
+	}
+}
@@ -0,0 +1,47 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+// RenderQueue
+////////////////////////////////////////////////////////////////////////////////
+// Draws of a frame as 32 bit sort keys with the index of their item, ordered
+// with an LSD radix sort in O(n). The sort is stable, draws with the same key
+// keep the order they were pushed in. Only the bits that differ between the
+// keys are sorted: each digit starts at the lowest varying bit the previous
+// ones didn't cover, so the constant fields of the render keys (the upper
+// bits of y, unused layers and texture indices) cost no pass. The buffers
+// only grow, a steady frame makes no allocation.
+////////////////////////////////////////////////////////////////////////////////
+class RenderQueue 
+{
+private:
+	static constexpr int RADIX_BITS = 11;
+	static constexpr int RADIX_BUCKETS = 1 << RADIX_BITS;
+	static constexpr int RADIX_DIGITS = (32 + RADIX_BITS - 1) / RADIX_BITS;
+
+	// Key in the high half, item index in the low half, so a pass moves a single word
+	std::vector<uint64_t> entries;
+
+	// Ping-pong buffer of the radix sort
+	std::vector<uint64_t> sorted_entries;
+	std::vector<uint32_t> histogram;
+
+public:
+	RenderQueue() = default;
+	~RenderQueue() = default;
+
+	void clear() { entries.clear(); }
+	void push(uint32_t key, uint32_t item) { entries.push_back((static_cast<uint64_t>(key) << 32) | item); }
+	void sort();
+
+	size_t size() const { return entries.size(); }
+	// Index of the item drawn in the given position, valid after sort()
+	uint32_t get_item(size_t position) const { return static_cast<uint32_t>(entries[position]); }
+	uint32_t get_key(size_t position) const { return static_cast<uint32_t>(entries[position] >> 32); }
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include "RenderThread.h"
+#include "../Logger/Logger.h"
+
+RenderThread::~RenderThread() 
+{
+	stop();
+}
+
+bool RenderThread::start(const std::function<SDL_Renderer*()>& create_renderer) 
+{
+	// Some backends bind the renderer to the thread that creates it, so it is created over there
+	std::promise<bool> started;
+	std::future<bool> created = started.get_future();
+	quit = false;
+	thread = std::thread([this, &create_renderer, &started]() {
+		renderer = create_renderer();
+		started.set_value(renderer != nullptr);
+		if (renderer) 
+		{
+			loop();
+		}
+	});
+
+	if (!created.get()) 
+	{
+		thread.join();
+		return false;
+	}
+	return true;
+}
+
+void RenderThread::stop() 
+{
+	if (!thread.joinable()) 
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	cv.notify_all();
+	thread.join();
+}
+
+void RenderThread::loop() 
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) 
+	{
+		cv.wait(lock, [this]() { return frame_pending || !tasks.empty() || quit; });
+
+		// Frames first, a task queued after a frame may destroy what the frame draws
+		if (frame_pending) 
+		{
+			const RenderCommandList& frame = commands[record_index ^ 1];
+			lock.unlock();
+
+			// The overlay is drawn between the frame and the present, and left out of the numbers
+			RenderStats stats;
+			const Uint64 start = SDL_GetPerformanceCounter();
+			frame.execute(renderer, batch, batched, &stats);
+			const Uint64 overlay_start = SDL_GetPerformanceCounter();
+			frame.execute_overlay(renderer, batch);
+			const Uint64 overlay_end = SDL_GetPerformanceCounter();
+			SDL_RenderPresent(renderer);
+			const Uint64 end = SDL_GetPerformanceCounter();
+			frame_ms = static_cast<double>((overlay_start - start) + (end - overlay_end)) * 1000.0 / SDL_GetPerformanceFrequency();
+			draw_calls = stats.draw_calls;
+			texture_switches = stats.texture_switches;
+
+			lock.lock();
+			frame_pending = false;
+			cv.notify_all();
+		}
+		else if (!tasks.empty()) 
+		{
+			const std::function<void(SDL_Renderer*)>* task = tasks.front();
+			lock.unlock();
+
+			(*task)(renderer);
+
+			lock.lock();
+			tasks.pop_front();
+			cv.notify_all();
+		}
+		else 
+		{
+			break;
+		}
+	}
+	lock.unlock();
+
+	SDL_DestroyRenderer(renderer);
+	renderer = nullptr;
+}
+
+void RenderThread::submit() 
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	cv.wait(lock, [this]() { return !frame_pending; });
+
+	// The recorded list goes to the render thread, the one it executed is recorded next
+	record_index ^= 1;
+	frame_pending = true;
+	commands[record_index].reset();
+	cv.notify_all();
+}
+
+void RenderThread::invoke(const std::function<void(SDL_Renderer*)>& task) 
+{
+	if (!thread.joinable()) 
+	{
+		Logger::Err("The render thread is not running");
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	tasks.push_back(&task);
+	cv.notify_all();
+
+	// The task is popped once it has run
+	cv.wait(lock, [this, &task]() {
+		for (auto pending_task : tasks) 
+		{
+			if (pending_task == &task) 
+			{
+				return false;
+			}
+		}
+		return true;
+	});
+}
@@ -0,0 +1,77 @@
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include "RenderCommandList.h"
+#include "SpriteBatch.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// RenderThread
+////////////////////////////////////////////////////////////////////////////////
+// Thread that owns the SDL_Renderer. The game thread records a frame into one
+// command list while the render thread executes and presents the previous
+// one, so the simulation of a frame overlaps the submission of the last.
+// Work that needs the renderer outside of a frame (creating or destroying
+// textures) is handed over with invoke(), which waits for it to be done.
+////////////////////////////////////////////////////////////////////////////////
+class RenderThread 
+{
+private:
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool quit = false;
+
+	// Only touched by the render thread once it started
+	SDL_Renderer* renderer = nullptr;
+	SpriteBatch batch;
+
+	// The game thread records into commands[record_index], the other one belongs to the render thread
+	RenderCommandList commands[2];
+	int record_index = 0;
+	bool frame_pending = false;
+
+	std::deque<const std::function<void(SDL_Renderer*)>*> tasks;
+	std::atomic<int> draw_calls{ 0 };
+	std::atomic<int> texture_switches{ 0 };
+	std::atomic<double> frame_ms{ 0.0 };
+	std::atomic<bool> batched{ true };
+
+	void loop();
+
+public:
+	RenderThread() = default;
+	~RenderThread();
+
+	// Creates the renderer on the render thread, false if it couldn't be created
+	bool start(const std::function<SDL_Renderer*()>& create_renderer);
+	// Finishes the pending frame, destroys the renderer and joins the thread
+	void stop();
+
+	RenderCommandList& get_commands() { return commands[record_index]; }
+	// Hands the recorded frame over, after the previous one has been presented
+	void submit();
+	// Runs the task on the render thread, after the frames already submitted, and waits for it
+	void invoke(const std::function<void(SDL_Renderer*)>& task);
+
+	// Draw calls and texture switches of the last frame presented, without the overlay
+	int get_draw_calls() const { return draw_calls; }
+	int get_texture_switches() const { return texture_switches; }
+	// Time the last frame took to execute and present without the overlay, in milliseconds
+	double get_frame_ms() const { return frame_ms; }
+
+	// Draw every quad on its own instead of batching them, applies from the next frame
+	void set_batched(bool batched) { this->batched = batched; }
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "SpriteBatch.h"
+
+#include <cmath>
+
+void SpriteBatch::begin(SDL_Renderer* renderer) 
+{
+	this->renderer = renderer;
+	texture = nullptr;
+	vertices.clear();
+	indices.clear();
+	draw_calls = 0;
+}
+
+void SpriteBatch::draw(SDL_Texture* texture, const SDL_Rect& src_rect, const SDL_FRect& dst_rect, double angle, SDL_Color color) 
+{
+	// A different texture ends the current run of quads
+	if (texture != this->texture) 
+	{
+		flush();
+		this->texture = texture;
+
+		int w = 1, h = 1;
+		SDL_QueryTexture(texture, NULL, NULL, &w, &h);
+		texture_width = static_cast<float>(w);
+		texture_height = static_cast<float>(h);
+	}
+
+	const float u0 = src_rect.x / texture_width;
+	const float v0 = src_rect.y / texture_height;
+	const float u1 = (src_rect.x + src_rect.w) / texture_width;
+	const float v1 = (src_rect.y + src_rect.h) / texture_height;
+
+	// Corners relative to the center of the quad, in clockwise order starting top left
+	const float half_w = dst_rect.w * 0.5f;
+	const float half_h = dst_rect.h * 0.5f;
+	const float center_x = dst_rect.x + half_w;
+	const float center_y = dst_rect.y + half_h;
+	float corners_x[4] = { -half_w, half_w, half_w, -half_w };
+	float corners_y[4] = { -half_h, -half_h, half_h, half_h };
+	const float corners_u[4] = { u0, u1, u1, u0 };
+	const float corners_v[4] = { v0, v0, v1, v1 };
+
+	if (angle != 0.0) 
+	{
+		// Positive angles turn clockwise on screen, like SDL_RenderCopyEx
+		const float radians = static_cast<float>(angle * M_PI / 180.0);
+		const float c = std::cos(radians);
+		const float s = std::sin(radians);
+		for (int i = 0; i < 4; i++) 
+		{
+			const float x = corners_x[i];
+			const float y = corners_y[i];
+			corners_x[i] = x * c - y * s;
+			corners_y[i] = x * s + y * c;
+		}
+	}
+
+	const int first = vertices.size();
+	for (int i = 0; i < 4; i++) 
+	{
+		SDL_Vertex vertex;
+		vertex.position = { center_x + corners_x[i], center_y + corners_y[i] };
+		vertex.color = color;
+		vertex.tex_coord = { corners_u[i], corners_v[i] };
+		vertices.push_back(vertex);
+	}
+
+	// Two triangles per quad
+	const int quad_indices[6] = { 0, 1, 2, 0, 2, 3 };
+	for (int index : quad_indices) 
+	{
+		indices.push_back(first + index);
+	}
+}
+
+void SpriteBatch::flush() 
+{
+	if (indices.empty()) 
+	{
+		return;
+	}
+
+	SDL_RenderGeometry(renderer, texture, vertices.data(), vertices.size(), indices.data(), indices.size());
+	draw_calls++;
+
+	vertices.clear();
+	indices.clear();
+}
+
+void SpriteBatch::end() 
+{
+	flush();
+	texture = nullptr;
+}
@@ -0,0 +1,49 @@
+#ifndef SPRITEBATCH_H
+#define SPRITEBATCH_H
+
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// SpriteBatch
+////////////////////////////////////////////////////////////////////////////////
+// Collects textured quads into a vertex/index buffer and submits them with a
+// single SDL_RenderGeometry call per run of quads sharing the same texture.
+// Quads are submitted in the order they were drawn, so the painter's order of
+// the caller is preserved.
+////////////////////////////////////////////////////////////////////////////////
+class SpriteBatch 
+{
+private:
+	SDL_Renderer* renderer = nullptr;
+
+	// Texture of the quads waiting to be submitted, and its size to compute the uvs
+	SDL_Texture* texture = nullptr;
+	float texture_width = 1.0f;
+	float texture_height = 1.0f;
+
+	// Reused from frame to frame, they only grow
+	std::vector<SDL_Vertex> vertices;
+	std::vector<int> indices;
+
+	int draw_calls = 0;
+
+public:
+	SpriteBatch() = default;
+	~SpriteBatch() = default;
+
+	void begin(SDL_Renderer* renderer);
+
+	// Same arguments as SDL_RenderCopyEx: the quad rotates around the center of dst, angle in degrees
+	void draw(SDL_Texture* texture, const SDL_Rect& src_rect, const SDL_FRect& dst_rect, double angle = 0.0, SDL_Color color = { 255, 255, 255, 255 });
+
+	// Submits the pending quads
+	void flush();
+	void end();
+
+	int get_draw_calls() const { return draw_calls; }
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "SpatialGrid.h"
+
+void SpatialGrid::update(int entity_id, float x, float y, float w, float h) 
+{
+	if (w > max_extent) 
+	{
+		max_extent = w;
+	}
+	if (h > max_extent) 
+	{
+		max_extent = h;
+	}
+
+	const std::uint64_t key = cell_key(cell_coord(x), cell_coord(y));
+	if (contains(entity_id)) 
+	{
+		// Still in the same cell, which is what happens to almost every entity on almost every frame
+		if (entries[entity_id].cell_key == key) 
+		{
+			return;
+		}
+		remove(entity_id);
+	}
+
+	if (entity_id >= static_cast<int>(entries.size())) 
+	{
+		entries.resize(entity_id + 1, { 0, -1 });
+	}
+	auto& cell = cells[key];
+	entries[entity_id] = { key, static_cast<int>(cell.size()) };
+	cell.push_back(entity_id);
+}
+
+void SpatialGrid::remove(int entity_id) 
+{
+	if (!contains(entity_id)) 
+	{
+		return;
+	}
+
+	// Move the last entity of the cell into the hole
+	Entry& entry = entries[entity_id];
+	auto& cell = cells[entry.cell_key];
+	const int last_id = cell.back();
+	cell[entry.index_in_cell] = last_id;
+	entries[last_id].index_in_cell = entry.index_in_cell;
+	cell.pop_back();
+
+	entry = { 0, -1 };
+}
+
+void SpatialGrid::clear() 
+{
+	cells.clear();
+	entries.clear();
+	max_extent = 0.0f;
+}
@@ -0,0 +1,88 @@
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <vector>
+#include <unordered_map>
+#include <cmath>
+#include <cstdint>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// SpatialGrid
+////////////////////////////////////////////////////////////////////////////////
+// Uniform grid of square cells over world space. Every entity is stored in the
+// cell that contains the top left corner of its bounds, so a query only visits
+// the cells overlapping the area (grown by the largest entity size), and moving
+// an entity is O(1). Cells are hashed, the world has no fixed bounds.
+////////////////////////////////////////////////////////////////////////////////
+class SpatialGrid 
+{
+private:
+	struct Entry 
+	{
+		std::uint64_t cell_key;
+		// -1 when the entity is not in the grid
+		int index_in_cell;
+	};
+
+	int cell_size;
+	float max_extent = 0.0f;
+
+	// [Map key = packed cell coordinates]
+	std::unordered_map<std::uint64_t, std::vector<int>> cells;
+
+	// [Vector index = entity id]
+	std::vector<Entry> entries;
+
+	std::uint64_t cell_key(int cell_x, int cell_y) const 
+	{
+		return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(cell_x)) << 32) | static_cast<std::uint32_t>(cell_y);
+	}
+
+	int cell_coord(float value) const { return static_cast<int>(std::floor(value / cell_size)); }
+
+public:
+	SpatialGrid(int cell_size = 256) : cell_size{ cell_size } {}
+
+	bool contains(int entity_id) const 
+	{
+		return entity_id < static_cast<int>(entries.size()) && entries[entity_id].index_in_cell != -1;
+	}
+
+	// Adds the entity, or moves it to the cell of its new position
+	void update(int entity_id, float x, float y, float w, float h);
+	void remove(int entity_id);
+	void clear();
+
+	int get_cell_size() const { return cell_size; }
+
+	// Calls func(entity_id) for every entity whose cell may overlap the area
+	template <typename Tfunc>
+	void query(const SDL_Rect& area, Tfunc&& func) const 
+	{
+		const int min_x = cell_coord(area.x - max_extent);
+		const int min_y = cell_coord(area.y - max_extent);
+		const int max_x = cell_coord(static_cast<float>(area.x + area.w));
+		const int max_y = cell_coord(static_cast<float>(area.y + area.h));
+
+		for (int cell_y = min_y; cell_y <= max_y; cell_y++) 
+		{
+			for (int cell_x = min_x; cell_x <= max_x; cell_x++) 
+			{
+				auto cell = cells.find(cell_key(cell_x, cell_y));
+				if (cell == cells.end()) 
+				{
+					continue;
+				}
+				for (int entity_id : cell->second) 
+				{
+					func(entity_id);
+				}
+			}
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,179 @@
+#include "FogOfWar.h"
+#include "../Logger/Logger.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Alpha of the fog over the tiles never seen, seen before, and seen now
+static const Uint32 FOG_UNEXPLORED = 0xFF000000;
+static const Uint32 FOG_EXPLORED = 0xA0000000;
+static const Uint32 FOG_VISIBLE = 0x00000000;
+
+void FogOfWar::resize(int num_cols, int num_rows, float tile_world_size) 
+{
+	this->num_cols = num_cols;
+	this->num_rows = num_rows;
+	this->tile_world_size = tile_world_size;
+
+	const int num_tiles = num_cols * num_rows;
+	viewers.assign(num_tiles, 0);
+	explored.assign((num_tiles + 63) / 64, 0);
+	pixels.assign(num_tiles, FOG_UNEXPLORED);
+	dirty_rows.assign((num_rows + 63) / 64, ~uint64_t(0));
+}
+
+void FogOfWar::update_pixel(int index) 
+{
+	Uint32 pixel = FOG_UNEXPLORED;
+	if (viewers[index] > 0) 
+	{
+		pixel = FOG_VISIBLE;
+	}
+	else if (test_bit(explored, index)) 
+	{
+		pixel = FOG_EXPLORED;
+	}
+
+	if (pixels[index] != pixel) 
+	{
+		pixels[index] = pixel;
+		set_bit(dirty_rows, index / num_cols);
+	}
+}
+
+void FogOfWar::add_disc(int col, int row, int radius, int delta) 
+{
+	const int first_row = std::max(row - radius, 0);
+	const int last_row = std::min(row + radius, num_rows - 1);
+	for (int tile_row = first_row; tile_row <= last_row; tile_row++) 
+	{
+		// Half width of the disc on this row
+		const int dy = tile_row - row;
+		const int half = static_cast<int>(std::sqrt(static_cast<float>(radius * radius - dy * dy)) + 0.5f);
+		const int first_col = std::max(col - half, 0);
+		const int last_col = std::min(col + half, num_cols - 1);
+		for (int tile_col = first_col; tile_col <= last_col; tile_col++) 
+		{
+			const int index = tile_row * num_cols + tile_col;
+			const int count = viewers[index] + delta;
+			viewers[index] = static_cast<uint16_t>(std::max(count, 0));
+
+			// Only the first viewer in and the last one out change what the tile looks like
+			if ((delta > 0 && count == delta) || (delta < 0 && count <= 0)) 
+			{
+				set_bit(explored, index);
+				update_pixel(index);
+			}
+		}
+	}
+}
+
+void FogOfWar::move_viewer(int from_col, int from_row, int to_col, int to_row, int radius) 
+{
+	if (from_col == to_col && from_row == to_row) 
+	{
+		return;
+	}
+
+	// Adding first, the tiles both discs cover never drop to 0 viewers
+	add_disc(to_col, to_row, radius, 1);
+	add_disc(from_col, from_row, radius, -1);
+}
+
+bool FogOfWar::is_visible(int col, int row) const 
+{
+	if (col < 0 || col >= num_cols || row < 0 || row >= num_rows) 
+	{
+		return false;
+	}
+	return viewers[row * num_cols + col] > 0;
+}
+
+bool FogOfWar::is_explored(int col, int row) const 
+{
+	if (col < 0 || col >= num_cols || row < 0 || row >= num_rows) 
+	{
+		return false;
+	}
+	return test_bit(explored, row * num_cols + col);
+}
+
+void FogOfWar::create_texture(SDL_Renderer* renderer) 
+{
+	if (texture && texture_cols == num_cols && texture_rows == num_rows) 
+	{
+		std::fill(dirty_rows.begin(), dirty_rows.end(), ~uint64_t(0));
+		return;
+	}
+	destroy();
+	if (num_cols <= 0 || num_rows <= 0) 
+	{
+		return;
+	}
+
+	texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, num_cols, num_rows);
+	if (!texture) 
+	{
+		Logger::Err("Error creating the fog of war texture: " + std::string(SDL_GetError()));
+		return;
+	}
+	// Stretched over the map, the edges of the fog fade over a tile
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+	SDL_SetTextureScaleMode(texture, SDL_ScaleModeLinear);
+	texture_cols = num_cols;
+	texture_rows = num_rows;
+	std::fill(dirty_rows.begin(), dirty_rows.end(), ~uint64_t(0));
+}
+
+void FogOfWar::destroy() 
+{
+	if (texture) 
+	{
+		SDL_DestroyTexture(texture);
+		texture = nullptr;
+	}
+	texture_cols = 0;
+	texture_rows = 0;
+}
+
+void FogOfWar::render(RenderCommandList& commands, const SDL_Rect& camera) 
+{
+	uploaded_rows = 0;
+	if (!texture) 
+	{
+		return;
+	}
+
+	// One upload per run of consecutive rows that changed
+	int row = 0;
+	while (row < num_rows) 
+	{
+		if (!test_bit(dirty_rows, row)) 
+		{
+			row++;
+			continue;
+		}
+		int end_row = row + 1;
+		while (end_row < num_rows && test_bit(dirty_rows, end_row)) 
+		{
+			end_row++;
+		}
+
+		Uint32* rows = commands.update_texture(texture, { 0, row, num_cols, end_row - row });
+		if (rows) 
+		{
+			std::memcpy(rows, &pixels[row * num_cols], (end_row - row) * num_cols * sizeof(Uint32));
+		}
+		uploaded_rows += end_row - row;
+		row = end_row;
+	}
+	std::fill(dirty_rows.begin(), dirty_rows.end(), 0);
+
+	const SDL_Rect dst_rect = {
+		-camera.x,
+		-camera.y,
+		static_cast<int>(num_cols * tile_world_size),
+		static_cast<int>(num_rows * tile_world_size)
+	};
+	commands.copy(texture, dst_rect);
+}
@@ -0,0 +1,79 @@
+#ifndef FOGOFWAR_H
+#define FOGOFWAR_H
+
+#include "../Renderer/RenderCommandList.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// FogOfWar
+////////////////////////////////////////////////////////////////////////////////
+// Visibility of the tiles of a level. Every viewer sees a disc of tiles around
+// it, and each tile counts the viewers that see it, so a viewer moving to the
+// next tile only adds and removes the edges of its disc. Tiles seen once stay
+// explored, one bit each. The fog is a streaming texture of one pixel per tile
+// stretched over the map; only the rows that changed since the last frame are
+// uploaded, recorded into the frame's command list.
+// create_texture() and destroy() have to run on the thread that owns the renderer.
+////////////////////////////////////////////////////////////////////////////////
+class FogOfWar 
+{
+private:
+	int num_cols = 0;
+	int num_rows = 0;
+	float tile_world_size = 1.0f;
+
+	// [Vector index = row * num_cols + col] Number of viewers that see the tile
+	std::vector<uint16_t> viewers;
+	// One bit per tile, same index
+	std::vector<uint64_t> explored;
+	// One pixel per tile, uploaded to the texture
+	std::vector<Uint32> pixels;
+	// One bit per row, the rows of pixels that changed since the last upload
+	std::vector<uint64_t> dirty_rows;
+	SDL_Texture* texture = nullptr;
+	int texture_cols = 0;
+	int texture_rows = 0;
+	int uploaded_rows = 0;
+
+	static bool test_bit(const std::vector<uint64_t>& bits, int index) { return (bits[index >> 6] >> (index & 63)) & 1; }
+	static void set_bit(std::vector<uint64_t>& bits, int index) { bits[index >> 6] |= uint64_t(1) << (index & 63); }
+
+	// Adds delta to the viewer count of the tiles of the disc, the pixels follow the tiles that change state
+	void add_disc(int col, int row, int radius, int delta);
+	void update_pixel(int index);
+
+public:
+	FogOfWar() = default;
+	~FogOfWar() = default;
+
+	// Every tile unexplored and without viewers
+	void resize(int num_cols, int num_rows, float tile_world_size);
+
+	// Viewers are discs of radius tiles, centered on a tile that may be outside of the map
+	void add_viewer(int col, int row, int radius) { add_disc(col, row, radius, 1); }
+	void remove_viewer(int col, int row, int radius) { add_disc(col, row, radius, -1); }
+	void move_viewer(int from_col, int from_row, int to_col, int to_row, int radius);
+
+	int col_at(float x) const { return static_cast<int>(std::floor(x / tile_world_size)); }
+	int row_at(float y) const { return static_cast<int>(std::floor(y / tile_world_size)); }
+	bool is_visible(int col, int row) const;
+	bool is_explored(int col, int row) const;
+
+	// Creates the fog texture, or keeps the current one when it has the size of the map
+	void create_texture(SDL_Renderer* renderer);
+	void destroy();
+
+	// Uploads the rows that changed, then draws the fog over the map, relative to the camera
+	void render(RenderCommandList& commands, const SDL_Rect& camera);
+
+	// Rows uploaded by the last render
+	int get_uploaded_rows() const { return uploaded_rows; }
+};
+
+#endif
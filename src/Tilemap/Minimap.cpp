@@ -0,0 +1,127 @@
+#include "Minimap.h"
+#include "Tilemap.h"
+#include "../AssetStore/AssetStore.h"
+#include "../Logger/Logger.h"
+
+#include <algorithm>
+#include <cmath>
+
+void Minimap::create_texture(SDL_Renderer* renderer, const Tilemap& tilemap, int max_size) 
+{
+	baked = false;
+	const int map_width = tilemap.get_width();
+	const int map_height = tilemap.get_height();
+	if (map_width <= 0 || map_height <= 0 || max_size <= 0) 
+	{
+		destroy();
+		return;
+	}
+
+	scale = static_cast<float>(max_size) / std::max(map_width, map_height);
+	const int new_width = std::max(static_cast<int>(map_width * scale), 1);
+	const int new_height = std::max(static_cast<int>(map_height * scale), 1);
+	if (texture && new_width == width && new_height == height) 
+	{
+		return;
+	}
+	destroy();
+
+	texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, new_width, new_height);
+	if (!texture) 
+	{
+		Logger::Err("Error creating the minimap texture: " + std::string(SDL_GetError()));
+		return;
+	}
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+	width = new_width;
+	height = new_height;
+}
+
+void Minimap::destroy() 
+{
+	if (texture) 
+	{
+		SDL_DestroyTexture(texture);
+		texture = nullptr;
+	}
+	width = 0;
+	height = 0;
+	baked = false;
+}
+
+bool Minimap::begin_blips() 
+{
+	if (--frames_until_blips > 0) 
+	{
+		return false;
+	}
+	frames_until_blips = blip_interval;
+	blips.clear();
+	return true;
+}
+
+void Minimap::render(RenderCommandList& commands, AssetStore& asset_store, const Tilemap& tilemap, const SDL_Rect& camera, double dt) 
+{
+	if (!texture) 
+	{
+		return;
+	}
+
+	if (!baked) 
+	{
+		commands.set_target(texture);
+		commands.clear({ 0, 0, 0, 255 });
+		tilemap.render_scaled(commands, asset_store, scale);
+		commands.set_target(nullptr);
+		baked = true;
+	}
+
+	const int margin = 10;
+	const SDL_Rect area = { camera.w - width - margin, margin, width, height };
+	commands.copy(texture, area);
+
+	// Blips, then the outline of the camera, in minimap pixels
+	const int num_quads = static_cast<int>(blips.size()) + 4;
+	RenderVertices vertices = commands.add_quads(num_quads);
+	float* xy = vertices.xy;
+	SDL_Color* colors = vertices.colors;
+	auto add_quad = [&](float x0, float y0, float x1, float y1, SDL_Color color) {
+		const float corners[8] = { x0, y0, x1, y0, x1, y1, x0, y1 };
+		std::copy(corners, corners + 8, xy);
+		std::fill(colors, colors + 4, color);
+		xy += 8;
+		colors += 4;
+	};
+	const float half_blip = BLIP_SIZE * 0.5f;
+	for (const auto& blip : blips) 
+	{
+		const float x = std::min(std::max(blip.x * scale, 0.0f), static_cast<float>(width)) + area.x;
+		const float y = std::min(std::max(blip.y * scale, 0.0f), static_cast<float>(height)) + area.y;
+		add_quad(x - half_blip, y - half_blip, x + half_blip, y + half_blip, blip.color);
+	}
+	const SDL_Color view_color = { 255, 255, 255, 255 };
+	const float x0 = area.x + camera.x * scale;
+	const float y0 = area.y + camera.y * scale;
+	const float x1 = x0 + camera.w * scale;
+	const float y1 = y0 + camera.h * scale;
+	add_quad(x0, y0, x1, y0 + 1, view_color);
+	add_quad(x0, y1 - 1, x1, y1, view_color);
+	add_quad(x0, y0 + 1, x0 + 1, y1 - 1, view_color);
+	add_quad(x1 - 1, y0 + 1, x1, y1 - 1, view_color);
+
+	// The radar sweeps next to the map
+	const TextureRegion* radar = radar_id.empty() ? nullptr : asset_store.get_texture_region(radar_id);
+	if (radar) 
+	{
+		radar_time = std::fmod(radar_time + static_cast<float>(dt), RADAR_FRAMES * RADAR_FRAME_SECONDS);
+		const int frame = static_cast<int>(radar_time / RADAR_FRAME_SECONDS) % RADAR_FRAMES;
+		const SDL_Rect src_rect = { radar->rect.x + frame * RADAR_FRAME_SIZE, radar->rect.y, RADAR_FRAME_SIZE, RADAR_FRAME_SIZE };
+		const SDL_FRect dst_rect = {
+			static_cast<float>(area.x - RADAR_FRAME_SIZE - margin),
+			static_cast<float>(area.y),
+			static_cast<float>(RADAR_FRAME_SIZE),
+			static_cast<float>(RADAR_FRAME_SIZE)
+		};
+		commands.draw(radar->texture, src_rect, dst_rect);
+	}
+}
@@ -0,0 +1,79 @@
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include "../Renderer/RenderCommandList.h"
+
+#include <string>
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+class AssetStore;
+class Tilemap;
+
+////////////////////////////////////////////////////////////////////////////////
+// Minimap
+////////////////////////////////////////////////////////////////////////////////
+// Whole level scaled down in a corner of the screen, next to an animated radar.
+// The tiles are baked once into a render target; every frame draws it with a
+// single copy, then the unit blips and the camera outline with a single
+// geometry command. The blips are only collected every few frames, from the
+// units the minimap system tracks.
+// create_texture() and destroy() have to run on the thread that owns the renderer.
+////////////////////////////////////////////////////////////////////////////////
+class Minimap 
+{
+private:
+	static constexpr int RADAR_FRAMES = 8;
+	static constexpr int RADAR_FRAME_SIZE = 64;
+	static constexpr float RADAR_FRAME_SECONDS = 0.125f;
+	static constexpr int BLIP_SIZE = 3;
+
+	struct Blip 
+	{
+		// World space
+		float x;
+		float y;
+		SDL_Color color;
+	};
+
+	SDL_Texture* texture = nullptr;
+	int width = 0;
+	int height = 0;
+	// Minimap pixels per world pixel
+	float scale = 1.0f;
+	bool baked = false;
+
+	std::vector<Blip> blips;
+	int blip_interval = 4;
+	int frames_until_blips = 0;
+
+	std::string radar_id;
+	float radar_time = 0.0f;
+
+public:
+	Minimap() = default;
+	~Minimap() = default;
+
+	// Sized so the longest side of the map fits in max_size pixels, baked on the next render
+	void create_texture(SDL_Renderer* renderer, const Tilemap& tilemap, int max_size);
+	void destroy();
+	// The tiles changed, bake them again on the next render
+	void invalidate() { baked = false; }
+
+	// Radar sweep spritesheet, RADAR_FRAMES square frames in a row
+	void set_radar(const std::string& asset_id) { radar_id = asset_id; }
+	void set_blip_interval(int frames) { blip_interval = frames > 0 ? frames : 1; }
+
+	// True every blip_interval frames: the blips of the last time are cleared, add the current ones
+	bool begin_blips();
+	void add_blip(float x, float y, SDL_Color color) { blips.push_back({ x, y, color }); }
+
+	// Bakes the tiles if needed, then draws the minimap in the top right corner of the camera
+	void render(RenderCommandList& commands, AssetStore& asset_store, const Tilemap& tilemap, const SDL_Rect& camera, double dt);
+
+	int get_blip_count() const { return static_cast<int>(blips.size()); }
+};
+
+#endif
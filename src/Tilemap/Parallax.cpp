@@ -0,0 +1,114 @@
+#include "Parallax.h"
+#include "../AssetStore/AssetStore.h"
+#include "../Logger/Logger.h"
+
+#include <algorithm>
+#include <cmath>
+
+void Parallax::add_layer(const std::string& asset_id, float factor, float scale, int gap_x, int gap_y, int z_index) 
+{
+	Layer layer;
+	layer.asset_id = asset_id;
+	layer.factor = factor;
+	layer.scale = scale;
+	layer.gap_x = gap_x;
+	layer.gap_y = gap_y;
+	layer.z_index = z_index;
+	layers.push_back(layer);
+}
+
+void Parallax::create_textures(SDL_Renderer* renderer, AssetStore& asset_store, int view_w, int view_h) 
+{
+	destroy();
+	this->view_w = view_w;
+	this->view_h = view_h;
+
+	for (auto& layer : layers) 
+	{
+		const TextureRegion* image = asset_store.get_texture_region(layer.asset_id);
+		if (!image) 
+		{
+			Logger::Err("Parallax layer image " + layer.asset_id + " is not loaded");
+			continue;
+		}
+		layer.cell_w = static_cast<int>(image->rect.w * layer.scale) + layer.gap_x;
+		layer.cell_h = static_cast<int>(image->rect.h * layer.scale) + layer.gap_y;
+		if (layer.cell_w <= 0 || layer.cell_h <= 0) 
+		{
+			continue;
+		}
+
+		// Whole cells, one more than the view needs so any scroll offset within a cell is covered
+		layer.texture_w = (view_w / layer.cell_w + 2) * layer.cell_w;
+		layer.texture_h = (view_h / layer.cell_h + 2) * layer.cell_h;
+		layer.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, layer.texture_w, layer.texture_h);
+		if (!layer.texture) 
+		{
+			Logger::Err("Error creating a parallax layer texture: " + std::string(SDL_GetError()));
+			continue;
+		}
+		SDL_SetTextureBlendMode(layer.texture, SDL_BLENDMODE_BLEND);
+		layer.baked = false;
+	}
+}
+
+void Parallax::destroy() 
+{
+	for (auto& layer : layers) 
+	{
+		if (layer.texture) 
+		{
+			SDL_DestroyTexture(layer.texture);
+			layer.texture = nullptr;
+		}
+		layer.baked = false;
+	}
+}
+
+void Parallax::bake(RenderCommandList& commands, AssetStore& asset_store) 
+{
+	bool baked_any = false;
+	for (auto& layer : layers) 
+	{
+		const TextureRegion* image = asset_store.get_texture_region(layer.asset_id);
+		if (!layer.texture || layer.baked || !image) 
+		{
+			continue;
+		}
+
+		commands.set_target(layer.texture);
+		commands.clear({ 0, 0, 0, 0 });
+		const float image_w = static_cast<float>(layer.cell_w - layer.gap_x);
+		const float image_h = static_cast<float>(layer.cell_h - layer.gap_y);
+		for (int y = 0; y < layer.texture_h; y += layer.cell_h) 
+		{
+			for (int x = 0; x < layer.texture_w; x += layer.cell_w) 
+			{
+				commands.draw(image->texture, image->rect, { static_cast<float>(x), static_cast<float>(y), image_w, image_h });
+			}
+		}
+		layer.baked = true;
+		baked_any = true;
+	}
+
+	if (baked_any) 
+	{
+		commands.set_target(nullptr);
+	}
+}
+
+ParallaxDraw Parallax::get_draw(int layer_index, const SDL_Rect& camera) const 
+{
+	const Layer& layer = layers[layer_index];
+	if (!layer.baked) 
+	{
+		return { nullptr, { 0, 0, 0, 0 }, layer.z_index };
+	}
+
+	// Where the view starts inside a cell, the rest of the texture repeats the same cells
+	const int offset_x = static_cast<int>(std::floor(camera.x * layer.factor));
+	const int offset_y = static_cast<int>(std::floor(camera.y * layer.factor));
+	const int src_x = ((offset_x % layer.cell_w) + layer.cell_w) % layer.cell_w;
+	const int src_y = ((offset_y % layer.cell_h) + layer.cell_h) % layer.cell_h;
+	return { layer.texture, { src_x, src_y, std::min(camera.w, view_w), std::min(camera.h, view_h) }, layer.z_index };
+}
@@ -0,0 +1,78 @@
+#ifndef PARALLAX_H
+#define PARALLAX_H
+
+#include "../Renderer/RenderCommandList.h"
+
+#include <string>
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+class AssetStore;
+
+// One layer as the render system draws it: src_rect of the texture copied 1:1 over the whole view
+struct ParallaxDraw 
+{
+	SDL_Texture* texture;
+	SDL_Rect src_rect;
+	int z_index;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Parallax
+////////////////////////////////////////////////////////////////////////////////
+// Layers of an image repeated over the view, scrolling at a fraction of the
+// camera speed. Each layer bakes its image once, already scaled, into a render
+// target one cell larger than the view on both axes; scrolling only moves the
+// source rectangle inside it, so a layer is a single copy per frame whatever
+// the number of repetitions on screen. The layers are drawn by the render
+// system, sorted with the sprites by their z_index.
+// create_textures() and destroy() have to run on the thread that owns the renderer.
+////////////////////////////////////////////////////////////////////////////////
+class Parallax 
+{
+private:
+	struct Layer 
+	{
+		std::string asset_id;
+		// 0 stays on screen, 1 moves with the world, above 1 moves faster (foreground)
+		float factor;
+		float scale;
+		// Space left between the repetitions, in view pixels
+		int gap_x;
+		int gap_y;
+		int z_index;
+
+		// Size of the image and its gap on screen
+		int cell_w = 0;
+		int cell_h = 0;
+		SDL_Texture* texture = nullptr;
+		int texture_w = 0;
+		int texture_h = 0;
+		bool baked = false;
+	};
+
+	std::vector<Layer> layers;
+	int view_w = 0;
+	int view_h = 0;
+
+public:
+	Parallax() = default;
+	~Parallax() = default;
+
+	void add_layer(const std::string& asset_id, float factor, float scale, int gap_x, int gap_y, int z_index);
+
+	// Textures for a view of view_w x view_h pixels, baked on the next bake(). The images have to be loaded.
+	void create_textures(SDL_Renderer* renderer, AssetStore& asset_store, int view_w, int view_h);
+	void destroy();
+
+	// Records the baking of the layers that need it, ends with the screen as the render target
+	void bake(RenderCommandList& commands, AssetStore& asset_store);
+
+	int get_layer_count() const { return static_cast<int>(layers.size()); }
+	// texture is nullptr until the layer is baked
+	ParallaxDraw get_draw(int layer, const SDL_Rect& camera) const;
+};
+
+#endif
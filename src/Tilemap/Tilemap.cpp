@@ -0,0 +1,309 @@
+#include "Tilemap.h"
+#include "../AssetStore/AssetStore.h"
+#include "../Logger/Logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+bool Tilemap::load(const std::string& file_path, const std::string& tileset_id, int num_cols, int num_rows, int tile_size, double tile_scale) 
+{
+	std::ifstream map_file(file_path);
+	if (!map_file) 
+	{
+		Logger::Err("Error opening the tilemap " + file_path);
+		return false;
+	}
+
+	this->tileset_id = tileset_id;
+	this->num_cols = num_cols;
+	this->num_rows = num_rows;
+	this->tile_size = tile_size;
+	this->tile_scale = tile_scale;
+	tiles.assign(num_cols * num_rows, { 0, 0 });
+
+	for (int row = 0; row < num_rows; row++) 
+	{
+		for (int col = 0; col < num_cols; col++) 
+		{
+			// Every tile is two digits, the row and the column of the tile in the tileset, and a separator
+			char ch;
+			map_file.get(ch);
+			const int src_y = (ch - '0') * tile_size;
+			map_file.get(ch);
+			const int src_x = (ch - '0') * tile_size;
+			map_file.ignore();
+
+			tiles[row * num_cols + col] = { static_cast<short>(src_x), static_cast<short>(src_y) };
+		}
+	}
+	return true;
+}
+
+void Tilemap::set_tile(int col, int row, int src_x, int src_y) 
+{
+	tiles[row * num_cols + col] = { static_cast<short>(src_x), static_cast<short>(src_y) };
+
+	if (!chunks.empty()) 
+	{
+		chunks[(row / CHUNK_TILES) * chunk_cols + col / CHUNK_TILES].dirty = true;
+	}
+}
+
+void Tilemap::create_chunks(SDL_Renderer* renderer, int view_w, int view_h) 
+{
+	destroy();
+
+	const int scaled_tile = static_cast<int>(tile_size * tile_scale);
+	chunk_size = CHUNK_TILES * scaled_tile;
+	chunk_cols = (num_cols + CHUNK_TILES - 1) / CHUNK_TILES;
+	chunk_rows = (num_rows + CHUNK_TILES - 1) / CHUNK_TILES;
+	if (chunk_size <= 0) 
+	{
+		return;
+	}
+
+	for (int chunk_row = 0; chunk_row < chunk_rows; chunk_row++) 
+	{
+		for (int chunk_col = 0; chunk_col < chunk_cols; chunk_col++) 
+		{
+			// The chunks on the right and bottom edges only cover the remaining tiles
+			const int cols = std::min(CHUNK_TILES, num_cols - chunk_col * CHUNK_TILES);
+			const int rows = std::min(CHUNK_TILES, num_rows - chunk_row * CHUNK_TILES);
+
+			Chunk chunk;
+			chunk.texture = nullptr;
+			chunk.world_rect = { chunk_col * chunk_size, chunk_row * chunk_size, cols * scaled_tile, rows * scaled_tile };
+			chunk.dirty = true;
+			chunks.push_back(chunk);
+		}
+	}
+
+	// A view overlaps at most view / chunk_size + 2 chunks on each axis, one more keeps
+	// the chunks that just scrolled off baked
+	const int pool_cols = std::min(view_w / chunk_size + 3, chunk_cols);
+	const int pool_rows = std::min(view_h / chunk_size + 3, chunk_rows);
+	for (int i = 0; i < pool_cols * pool_rows; i++) 
+	{
+		// Every texture has the size of a whole chunk, the ones on the edges leave the rest transparent
+		SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, chunk_size, chunk_size);
+		if (!texture) 
+		{
+			Logger::Err("Error creating a tilemap chunk texture: " + std::string(SDL_GetError()));
+			break;
+		}
+		SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+		textures.push_back(texture);
+	}
+	free_textures = textures;
+
+	Logger::Log("Tilemap split in " + std::to_string(chunks.size()) + " chunks, " + std::to_string(textures.size()) + " chunk textures");
+}
+
+void Tilemap::destroy() 
+{
+	for (auto texture : textures) 
+	{
+		SDL_DestroyTexture(texture);
+	}
+	textures.clear();
+	free_textures.clear();
+	resident_chunks.clear();
+	chunks.clear();
+}
+
+Tilemap::ChunkRange Tilemap::get_chunk_range(const SDL_Rect& area) const 
+{
+	if (chunk_size <= 0 || area.x + area.w <= 0 || area.y + area.h <= 0) 
+	{
+		return { 0, 0, 0, 0 };
+	}
+	return {
+		std::max(area.x / chunk_size, 0),
+		std::max(area.y / chunk_size, 0),
+		std::min((area.x + area.w + chunk_size - 1) / chunk_size, chunk_cols),
+		std::min((area.y + area.h + chunk_size - 1) / chunk_size, chunk_rows)
+	};
+}
+
+bool Tilemap::assign_texture(int chunk_index, const ChunkRange& visible) 
+{
+	if (free_textures.empty()) 
+	{
+		// Distance in chunks from the visible range, 0 for the chunks in it
+		int farthest = -1;
+		int farthest_distance = 0;
+		for (int i = 0; i < static_cast<int>(resident_chunks.size()); i++) 
+		{
+			const int col = resident_chunks[i] % chunk_cols;
+			const int row = resident_chunks[i] / chunk_cols;
+			const int distance_x = std::max(visible.first_col - col, col - (visible.last_col - 1));
+			const int distance_y = std::max(visible.first_row - row, row - (visible.last_row - 1));
+			const int distance = std::max(distance_x, distance_y);
+			if (distance > farthest_distance) 
+			{
+				farthest = i;
+				farthest_distance = distance;
+			}
+		}
+		if (farthest < 0) 
+		{
+			return false;
+		}
+
+		Chunk& evicted = chunks[resident_chunks[farthest]];
+		free_textures.push_back(evicted.texture);
+		evicted.texture = nullptr;
+		evicted.dirty = true;
+		resident_chunks[farthest] = resident_chunks.back();
+		resident_chunks.pop_back();
+	}
+
+	// The texture still holds the tiles of its previous chunk
+	Chunk& chunk = chunks[chunk_index];
+	chunk.texture = free_textures.back();
+	chunk.dirty = true;
+	free_textures.pop_back();
+	resident_chunks.push_back(chunk_index);
+	return true;
+}
+
+void Tilemap::bake(RenderCommandList& commands, AssetStore& asset_store, Chunk& chunk, int chunk_col, int chunk_row) 
+{
+	// The tileset can be a standalone texture or a region of an atlas page
+	const TextureRegion* tileset = asset_store.get_texture_region(tileset_id);
+	if (!tileset) 
+	{
+		return;
+	}
+
+	commands.set_target(chunk.texture);
+	commands.clear({ 0, 0, 0, 0 });
+
+	const float scaled_tile = static_cast<float>(tile_size * tile_scale);
+	const int first_col = chunk_col * CHUNK_TILES;
+	const int first_row = chunk_row * CHUNK_TILES;
+	const int last_col = std::min(first_col + CHUNK_TILES, num_cols);
+	const int last_row = std::min(first_row + CHUNK_TILES, num_rows);
+
+	for (int row = first_row; row < last_row; row++) 
+	{
+		for (int col = first_col; col < last_col; col++) 
+		{
+			const Tile& tile = tiles[row * num_cols + col];
+			const SDL_Rect src_rect = { tileset->rect.x + tile.src_x, tileset->rect.y + tile.src_y, tile_size, tile_size };
+			const SDL_FRect dst_rect = { (col - first_col) * scaled_tile, (row - first_row) * scaled_tile, scaled_tile, scaled_tile };
+			commands.draw(tileset->texture, src_rect, dst_rect);
+		}
+	}
+
+	commands.set_target(nullptr);
+	chunk.dirty = false;
+}
+
+void Tilemap::render(RenderCommandList& commands, AssetStore& asset_store, const SDL_Rect& camera) 
+{
+	bake_visible(commands, asset_store, camera);
+	draw(commands, camera, camera);
+}
+
+void Tilemap::bake_visible(RenderCommandList& commands, AssetStore& asset_store, const SDL_Rect& camera, std::vector<SDL_Rect>* baked_rects) 
+{
+	const ChunkRange visible = get_chunk_range(camera);
+	for (int chunk_row = visible.first_row; chunk_row < visible.last_row; chunk_row++) 
+	{
+		for (int chunk_col = visible.first_col; chunk_col < visible.last_col; chunk_col++) 
+		{
+			const int chunk_index = chunk_row * chunk_cols + chunk_col;
+			Chunk& chunk = chunks[chunk_index];
+			if (!chunk.texture && !assign_texture(chunk_index, visible)) 
+			{
+				continue;
+			}
+			if (!chunk.dirty) 
+			{
+				continue;
+			}
+			bake(commands, asset_store, chunk, chunk_col, chunk_row);
+			if (baked_rects) 
+			{
+				baked_rects->push_back(chunk.world_rect);
+			}
+		}
+	}
+}
+
+void Tilemap::draw(RenderCommandList& commands, const SDL_Rect& camera, const SDL_Rect& area) const 
+{
+	const ChunkRange range = get_chunk_range(area);
+	for (int chunk_row = range.first_row; chunk_row < range.last_row; chunk_row++) 
+	{
+		for (int chunk_col = range.first_col; chunk_col < range.last_col; chunk_col++) 
+		{
+			const Chunk& chunk = chunks[chunk_row * chunk_cols + chunk_col];
+			if (!chunk.texture || chunk.dirty) 
+			{
+				continue;
+			}
+
+			SDL_Rect dst_rect = { chunk.world_rect.x - camera.x, chunk.world_rect.y - camera.y, chunk_size, chunk_size };
+			commands.copy(chunk.texture, dst_rect);
+		}
+	}
+}
+
+void Tilemap::render_tiles(RenderCommandList& commands, AssetStore& asset_store, const SDL_Rect& camera) const 
+{
+	const TextureRegion* tileset = asset_store.get_texture_region(tileset_id);
+	if (!tileset || tiles.empty()) 
+	{
+		return;
+	}
+
+	const int scaled_tile = static_cast<int>(tile_size * tile_scale);
+	const int first_col = std::max(camera.x / scaled_tile, 0);
+	const int first_row = std::max(camera.y / scaled_tile, 0);
+	const int last_col = std::min((camera.x + camera.w) / scaled_tile + 1, num_cols);
+	const int last_row = std::min((camera.y + camera.h) / scaled_tile + 1, num_rows);
+
+	for (int row = first_row; row < last_row; row++) 
+	{
+		for (int col = first_col; col < last_col; col++) 
+		{
+			const Tile& tile = tiles[row * num_cols + col];
+			const SDL_Rect src_rect = { tileset->rect.x + tile.src_x, tileset->rect.y + tile.src_y, tile_size, tile_size };
+			const SDL_FRect dst_rect = { 
+				static_cast<float>(col * scaled_tile - camera.x), 
+				static_cast<float>(row * scaled_tile - camera.y), 
+				static_cast<float>(scaled_tile), 
+				static_cast<float>(scaled_tile) 
+			};
+			commands.draw(tileset->texture, src_rect, dst_rect);
+		}
+	}
+}
+
+void Tilemap::render_scaled(RenderCommandList& commands, AssetStore& asset_store, float scale) const 
+{
+	const TextureRegion* tileset = asset_store.get_texture_region(tileset_id);
+	if (!tileset || tiles.empty()) 
+	{
+		return;
+	}
+
+	// Tile edges snapped to whole pixels, without gaps between the tiles
+	const float scaled_tile = static_cast<float>(tile_size * tile_scale * scale);
+	for (int row = 0; row < num_rows; row++) 
+	{
+		const float y0 = std::floor(row * scaled_tile);
+		const float y1 = std::floor((row + 1) * scaled_tile);
+		for (int col = 0; col < num_cols; col++) 
+		{
+			const float x0 = std::floor(col * scaled_tile);
+			const float x1 = std::floor((col + 1) * scaled_tile);
+			const Tile& tile = tiles[row * num_cols + col];
+			const SDL_Rect src_rect = { tileset->rect.x + tile.src_x, tileset->rect.y + tile.src_y, tile_size, tile_size };
+			commands.draw(tileset->texture, src_rect, { x0, y0, x1 - x0, y1 - y0 });
+		}
+	}
+}
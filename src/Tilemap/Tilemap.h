@@ -0,0 +1,112 @@
+#ifndef TILEMAP_H
+#define TILEMAP_H
+
+#include "../Renderer/RenderCommandList.h"
+
+#include <string>
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+class AssetStore;
+
+////////////////////////////////////////////////////////////////////////////////
+// Tilemap
+////////////////////////////////////////////////////////////////////////////////
+// Static tile layer of a level. The tiles are baked into chunk render targets
+// of CHUNK_TILES x CHUNK_TILES tiles, already scaled, and each visible chunk is
+// drawn with a single copy. Changing a tile only re-bakes its chunk. The chunk
+// textures come from a pool sized for the view, not for the map: a chunk gets
+// one when it comes into view, and the chunks farthest off screen give theirs
+// back when the pool runs out. Only the chunks in view are ever visited.
+// Loading the tiles needs no renderer, so it can run on a worker thread;
+// create_chunks() and destroy() have to run on the thread that owns the
+// renderer. Baking and drawing are recorded into the frame's command list.
+////////////////////////////////////////////////////////////////////////////////
+class Tilemap 
+{
+private:
+	static constexpr int CHUNK_TILES = 16;
+
+	struct Tile 
+	{
+		// Source position in the tileset texture
+		short src_x;
+		short src_y;
+	};
+
+	struct Chunk 
+	{
+		// nullptr while the chunk has no texture from the pool
+		SDL_Texture* texture;
+		SDL_Rect world_rect;
+		bool dirty;
+	};
+
+	// Chunks overlapping an area, the last column and row excluded
+	struct ChunkRange 
+	{
+		int first_col;
+		int first_row;
+		int last_col;
+		int last_row;
+	};
+
+	std::string tileset_id;
+	int num_cols = 0;
+	int num_rows = 0;
+	int tile_size = 0;
+	double tile_scale = 1.0;
+
+	// [Vector index = row * num_cols + col]
+	std::vector<Tile> tiles;
+
+	// [Vector index = chunk row * chunk_cols + chunk col]
+	std::vector<Chunk> chunks;
+	int chunk_cols = 0;
+	int chunk_rows = 0;
+	// Width and height of a chunk texture, in world pixels
+	int chunk_size = 0;
+
+	// Every texture of the pool, the unused ones and the chunks holding the others
+	std::vector<SDL_Texture*> textures;
+	std::vector<SDL_Texture*> free_textures;
+	std::vector<int> resident_chunks;
+
+	ChunkRange get_chunk_range(const SDL_Rect& area) const;
+	// Gives the chunk a texture, taken from the resident chunk farthest outside of visible if none is free
+	bool assign_texture(int chunk_index, const ChunkRange& visible);
+	void bake(RenderCommandList& commands, AssetStore& asset_store, Chunk& chunk, int chunk_col, int chunk_row);
+
+public:
+	Tilemap() = default;
+	~Tilemap() = default;
+
+	// Reads a map file of num_cols x num_rows "yx" tileset coordinates
+	bool load(const std::string& file_path, const std::string& tileset_id, int num_cols, int num_rows, int tile_size, double tile_scale);
+
+	void set_tile(int col, int row, int src_x, int src_y);
+
+	// Splits the map in chunks and creates the texture pool for a view of view_w x view_h pixels.
+	// The chunks are baked when they first come into view.
+	void create_chunks(SDL_Renderer* renderer, int view_w, int view_h);
+	void destroy();
+
+	// Bakes the chunks that changed, then draws the ones overlapping the camera.
+	// Baking ends with the screen as the render target, don't record it while drawing into a texture.
+	void render(RenderCommandList& commands, AssetStore& asset_store, const SDL_Rect& camera);
+	// The two halves of render(). The world rectangles of the chunks baked are added to baked_rects.
+	void bake_visible(RenderCommandList& commands, AssetStore& asset_store, const SDL_Rect& camera, std::vector<SDL_Rect>* baked_rects = nullptr);
+	// Draws the chunks overlapping area, in world space, relative to the camera
+	void draw(RenderCommandList& commands, const SDL_Rect& camera, const SDL_Rect& area) const;
+	// Reference path for render regression checks: every visible tile drawn on its own, no chunks
+	void render_tiles(RenderCommandList& commands, AssetStore& asset_store, const SDL_Rect& camera) const;
+	// Every tile, scaled down from its world size by scale and drawn from the top left corner of the target
+	void render_scaled(RenderCommandList& commands, AssetStore& asset_store, float scale) const;
+
+	int get_width() const { return static_cast<int>(num_cols * tile_size * tile_scale); }
+	int get_height() const { return static_cast<int>(num_rows * tile_size * tile_scale); }
+};
+
+#endif